@@ -1,38 +1,75 @@
 #pragma once
 
 #include <memory>
+#include <bitset>
 
 #include "Oprd.h"
-#include "Rfc.h"
+#include "InstrWindow.h"
 #include "CfgParser.h"
 
 struct Rfc;
-    
+
+// What a miss on an operand does for the missing threads
+struct MissAct {
+    bool fill; // takes a cache block
+    bool dirty; // the block is dirty (destinations)
+    bool mrfRd; // the value is read from the MRF
+    bool mrfWr; // the value is written to the MRF instead of the cache
+};
+
+// Allocation policies. The simulation core (Rfc::run) is specialized per policy and calls the static miss()
+// of the concrete class, given the reuse flags of the instruction and the look-ahead window; fill() is the
+// runtime entry point for the other simulators (LaneSetSim)
 struct BaseAllocator {
-    virtual void alloc(const reg::Oprd &, uint32_t) = 0;
+    virtual ~BaseAllocator() = default;
+
+    // Whether a miss on the operand takes a cache block (the same for every thread of the warp)
+    virtual bool fill(const reg::Oprd &) const = 0;
 };
 
 // Write-allocate
-struct WriteAllocator : BaseAllocator {
+struct WriteAllocator final : BaseAllocator {
     Rfc * cc;
-    WriteAllocator(Rfc * cc) : cc(cc) {} 
-    void alloc(const reg::Oprd &, uint32_t) final;
+    WriteAllocator(Rfc * cc) : cc(cc) {}
+    bool fill(const reg::Oprd &) const final;
+
+    static MissAct miss(const reg::Oprd & oprd, const std::bitset<4> &, const InstrWindow &) noexcept {
+        const bool dst = oprd.type == reg::OprdT::dst;
+        return {dst, dst, oprd.type == reg::OprdT::src, false};
+    }
 };
 
 // Compiler-aided allocator
-struct CplAidedAllocator : BaseAllocator {
+struct CplAidedAllocator final : BaseAllocator {
     Rfc * cc;
-    CplAidedAllocator(Rfc * cc) : cc(cc) {} 
-    void alloc(const reg::Oprd &, uint32_t) final;
+    CplAidedAllocator(Rfc * cc) : cc(cc) {}
+    bool fill(const reg::Oprd &) const final;
+
+    static MissAct miss(const reg::Oprd & oprd, const std::bitset<4> & flags, const InstrWindow &) noexcept {
+        if (oprd.type == reg::OprdT::src)
+            return {flags.test(3 - oprd.pos), false, true, false};
+        const bool dst = oprd.type == reg::OprdT::dst;
+        return {dst, dst, false, false};
+    }
 };
 
-// Compiler-aided allocation with looking ahead
-struct LookAheadAllocator : BaseAllocator {
+// Compiler-aided allocation with looking ahead: destinations are cached only if the register is used again
+// within the look-ahead window, otherwise they are just written back
+struct LookAheadAllocator final : BaseAllocator {
     Rfc * cc;
-    LookAheadAllocator(Rfc * cc) : cc(cc) {} 
-    void alloc(const reg::Oprd &, uint32_t) final;
+    LookAheadAllocator(Rfc * cc) : cc(cc) {}
+    bool fill(const reg::Oprd &) const final;
+
+    static MissAct miss(const reg::Oprd & oprd, const std::bitset<4> & flags, const InstrWindow & win) noexcept {
+        if (oprd.type == reg::OprdT::src)
+            return {flags.test(3 - oprd.pos), false, true, false};
+        if (oprd.type != reg::OprdT::dst)
+            return {false, false, false, false};
+        const bool used = win.uses(oprd.index) != 0;
+        return {used, used, false, !used};
+    }
 };
 
 struct AllocatorFactory {
     static BaseAllocator * getInstance(Rfc *, const cfg::GlobalCfg&);
-};
\ No newline at end of file
+};
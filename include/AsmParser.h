@@ -11,20 +11,51 @@
 #include <bitset>
 #include <regex>
 #include <iomanip>
+#include <memory>
+#include <mutex>
+#include <future>
+#include <utility>
+
+#include "ReuseTab.h"
+#include "StaticInstrTab.h"
 
 struct AsmParser {
-	using mapT = std::unordered_map<uint32_t, std::bitset<4>>;
 	std::shared_ptr<std::ifstream> asmIfs;
-	std::shared_ptr<std::vector<mapT>> tab;
+	std::shared_ptr<std::vector<ReuseTab>> tab;
 	std::shared_ptr<std::unordered_map<std::string, size_t>> map;
+	std::shared_ptr<StaticInstrTab> sTab; // decoded static instructions, filled lazily by the trace readers
 
 	AsmParser();
     AsmParser(
 		const std::string&, 
-		const std::shared_ptr<std::vector<mapT>>&, 
+		const std::shared_ptr<std::vector<ReuseTab>>&, 
 		const std::shared_ptr<std::unordered_map<std::string, size_t>>&
 	);
+	~AsmParser();
+
+	AsmParser(const AsmParser&) = delete;
+	AsmParser & operator=(const AsmParser&) = delete;
 	
+	// Decodes every function
 	void parse();
+
+	// Records where each function starts; its reuse flags are decoded on the first find()
+	void index();
+	void indexAsync();
+
+	// Reuse table of a kernel, nullptr if the dump has no such function
+	const ReuseTab * find(const std::string&);
+
+private:
+	std::string text;
+	std::shared_future<void> indexed;
+	bool lazy = false;
+	size_t base = 0; // tab index of the first indexed function
+	std::vector<std::pair<size_t, size_t>> spans; // [begin, end) of each indexed function
+	std::unique_ptr<std::once_flag[]> once;
+
+	void load();
+	void parseText();
+	void decode(size_t);
 };
 
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <limits>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+// Lock-free single-producer / multi-consumer broadcast ring.
+// Every consumer observes every element in order; a slot is reused only
+// after all attached consumers have released it.
+template <typename T>
+class BcastRing {
+private:
+    static constexpr size_t lineSize = 64;
+    static constexpr uint64_t detached = std::numeric_limits<uint64_t>::max();
+
+    struct alignas(lineSize) Cursor {
+        std::atomic<uint64_t> pos{0};
+    };
+
+    std::vector<T> slots;
+    size_t capMask;
+
+    alignas(lineSize) std::atomic<uint64_t> head{0}; // # of published elements
+    alignas(lineSize) std::atomic<bool> closed{false};
+    std::unique_ptr<Cursor[]> tails; // # of elements released by each consumer
+    size_t nCons;
+
+    // Producer-local state
+    alignas(lineSize) uint64_t wr = 0;
+    uint64_t minTail = 0;
+
+    uint64_t scanTails() const noexcept {
+        uint64_t m = detached;
+        for (size_t i = 0; i < nCons; i++) {
+            auto t = tails[i].pos.load(std::memory_order_acquire);
+            if (t < m) m = t;
+        }
+        return m == detached ? wr : m;
+    }
+
+public:
+    // cap is rounded up to a power of two
+    explicit BcastRing(size_t cap, size_t nCons) : tails(new Cursor[nCons]), nCons(nCons) {
+        size_t n = 1;
+        while (n < cap) n <<= 1;
+        slots.resize(n);
+        capMask = n - 1;
+    }
+
+    BcastRing(const BcastRing&) = delete;
+    BcastRing & operator=(const BcastRing&) = delete;
+
+    // Producer: slot to fill next, blocks while the ring is full
+    T & claim() noexcept {
+        while (wr - minTail > capMask) {
+            minTail = scanTails();
+            if (wr - minTail > capMask)
+                std::this_thread::yield();
+        }
+        return slots[wr & capMask];
+    }
+
+    // Producer: makes the claimed slot visible to all consumers
+    void publish() noexcept {
+        head.store(++wr, std::memory_order_release);
+    }
+
+    // Producer: no more elements will be published
+    void close() noexcept {
+        closed.store(true, std::memory_order_release);
+    }
+
+    // Consumer: waits until elements [pos, end) are available, returns end (== pos once closed and drained)
+    uint64_t wait(uint64_t pos) const noexcept {
+        while (true) {
+            auto end = head.load(std::memory_order_acquire);
+            if (end != pos)
+                return end;
+            if (closed.load(std::memory_order_acquire))
+                return head.load(std::memory_order_acquire);
+            std::this_thread::yield();
+        }
+    }
+
+    const T & at(uint64_t pos) const noexcept {
+        return slots[pos & capMask];
+    }
+
+    // Consumer: every element before pos may be overwritten
+    void release(size_t cons, uint64_t pos) noexcept {
+        tails[cons].pos.store(pos, std::memory_order_release);
+    }
+
+    // Consumer: stop holding back the producer (e.g., after an error)
+    void detach(size_t cons) noexcept {
+        tails[cons].pos.store(detached, std::memory_order_release);
+    }
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unordered_map>
+#include <stdexcept>
+#include <cstdint>
+
+#include "Instr.h"
+#include "TraceParser.h"
+#include "TraceReader.h"
+#include "StaticInstrTab.h"
+
+// Binary trace format (little-endian)
+//
+//   header : magic "RFCBTRC\0", u32 version, u32 reserved
+//   records: u8 tag followed by its payload
+//     kernel : varint length, kernel symbol
+//     cta    : zigzag varint x, y, z
+//     warp   : varint warp id (resets the PC predictor to 0)
+//     def    : varint opcode, varint #operands, {u8 type, varint index, varint pos, varint set}
+//              interns an (opcode, operands) record; ids are assigned in order of definition
+//     inst   : zigzag varint PC delta, u32 mask, varint record id
+//     end    : end of trace
+namespace bt {
+
+    inline constexpr char magic[8] = {'R', 'F', 'C', 'B', 'T', 'R', 'C', '\0'};
+    inline constexpr uint32_t version = 1;
+    inline constexpr size_t headerSize = 16;
+
+    enum RecT : uint8_t {
+        end = 0,
+        kernel,
+        cta,
+        warp,
+        def,
+        inst
+    };
+
+    bool isBinTrace(const std::string&);
+
+}; // namespace bt
+
+class BinTraceWriter {
+private:
+    std::ofstream traceOfs;
+    std::string buf;
+
+    std::string kernelSym;
+    util::Dim3<int> blockId;
+    uint32_t wId;
+    uint32_t pc;
+    bool hasKernel;
+    bool hasBlock;
+    bool hasWarp;
+
+    // (opcode, operands) -> record id
+    std::unordered_map<std::string, uint32_t> recTab;
+
+    void flush();
+
+public:
+    explicit BinTraceWriter(const std::string&);
+    ~BinTraceWriter();
+
+    void write(const std::string&, const sass::Instr&);
+    void close();
+
+    // Converts an NVBit text trace, returns the number of instructions
+    static uint64_t convert(const std::string&, const std::string&);
+};
+
+class BinTraceReader : public BaseTraceReader {
+private:
+    struct Rec {
+        op::Opcode opcode;
+        std::vector<reg::Oprd> regPool;
+        std::string key; // encoded def payload
+    };
+
+    std::string traceFile;
+    const uint8_t * base;
+    size_t size;
+    const uint8_t * cur;
+    bool done;
+
+    KernelInfo kernelInfo;
+
+    std::shared_ptr<AsmParser> asmParser;
+    const ReuseTab * reuseTab; // resolved at the kernel record
+    uint64_t kernelOff; // of the kernel record
+
+    // (record id, pc) -> static instruction of the current kernel
+    std::shared_ptr<StaticInstrTab> sTab;
+    std::unordered_map<uint64_t, const sass::StaticInstr *> siCache;
+
+    util::Dim3<int> blockId;
+    uint32_t wId;
+    uint32_t pc;
+    std::vector<Rec> recs; // defined before scanOff
+    uint64_t nDef; // records defined before cur
+    uint64_t scanOff;
+
+    void open(const std::string&);
+    void close() noexcept;
+
+    uint8_t readU8();
+    uint32_t readU32();
+    uint64_t readVarint();
+    int64_t readZigzag();
+    void enterKernel();
+    void readDef();
+    void scanDefs(uint64_t);
+
+public:
+    explicit BinTraceReader(
+        const std::string &,
+        const std::shared_ptr<AsmParser>&
+    );
+    ~BinTraceReader();
+
+    BinTraceReader(const BinTraceReader&) = delete;
+    BinTraceReader & operator=(const BinTraceReader&) = delete;
+
+    bool eof() const override;
+    void reset(const std::string&) override;
+    const KernelInfo & info() const noexcept;
+    sass::Instr parse() override;
+    TraceMark mark() const override;
+    void seek(const TraceMark&) override;
+};
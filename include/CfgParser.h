@@ -30,7 +30,8 @@ namespace cfg {
 	// Replacement policy
     enum class ReplPlcy {
         lru = 0,
-        fifo
+        fifo,
+        opt // Belady's optimal replacement, an oracle (needs next-use annotated traces)
     };
 
 	// Eviction Policy
@@ -76,7 +77,8 @@ namespace cfg {
 
 	inline const std::unordered_map<ReplPlcy, std::string> repl2StrTab {
 		std::pair<ReplPlcy, std::string>(ReplPlcy::lru, "LRU"),
-		std::pair<ReplPlcy, std::string>(ReplPlcy::fifo, "FIFO")
+		std::pair<ReplPlcy, std::string>(ReplPlcy::fifo, "FIFO"),
+		std::pair<ReplPlcy, std::string>(ReplPlcy::opt, "OPT")
     };
 
     inline std::ostream & operator<<(std::ostream & os, const ReplPlcy & plcy) {
@@ -159,6 +161,7 @@ namespace cfg {
 	    std::shared_ptr<GlobalCfg> cfg;
     public: 
         explicit CfgParser(const std::string&, const std::shared_ptr<GlobalCfg>&);
+        CfgParser(const YAML::Node&, const std::shared_ptr<GlobalCfg>&);
 	    void parse();
         void print() const;
     }; 
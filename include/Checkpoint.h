@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "AsmParser.h"
+#include "Sim.h"
+
+// Checkpoints of a serial run: the trace position and the complete state of every Sim (CAM contents, look-ahead
+// windows, lane-folding classes, scoreboards), so that a run can be resumed after a crash, or a state warmed up
+// on a trace prefix forked into many configs.
+//
+// File (host byte order)
+//   header : magic "RFCCKPT\0", u32 version, u32 # of Sims, u64 # of kernels, u64 kernel, u64 instructions
+//            of that kernel, u64 instructions of the trace
+//   per Sim: u32 alloc, repl, evict, dest map, assoc, # of blocks, n_dw, bitwidth, window length,
+//            u8 kernel end, u64 baseline counters[8], u64 RFC counters[8]
+//     per warp slot: u32 clock, u32 tag, ts[# of blocks * 32], u8 dirty[# of blocks * 32], u32 memTag[...],
+//            u32 leaders, u32 classes[32], u64 # of window instructions, each as
+//            u8 valid, u32 pc, u32 opcode, u32 # of operands, {u32 type, index, pos, set}, u32 reuse flags,
+//            u32 mask, i32 CTA x, y, z, u32 warp id
+namespace Checkpoint {
+
+	inline constexpr char magic[8] = {'R', 'F', 'C', 'C', 'K', 'P', 'T', '\0'};
+	inline constexpr uint32_t version = 1;
+
+	// Next instruction to simulate
+	struct Pos {
+		uint64_t kernel = 0; // index in the kernel list
+		uint64_t inst = 0; // instructions of that kernel already simulated
+		uint64_t nInst = 0; // instructions of the trace already simulated
+	};
+
+	struct Plan {
+		std::string path; // written by the run, "" for none
+		uint64_t every = 0; // instructions between checkpoints, 0: none
+		uint64_t prefix = 0; // stop after the first instructions of the trace and checkpoint, 0: run to the end
+		std::string from; // checkpoint the run starts from, "" for none
+		bool fork = false; // start from a warm-up checkpoint of other configs, with the counters cleared
+	};
+
+	// Written to a temporary file and renamed, so an interrupted save keeps the previous checkpoint
+	void save(const std::string&, const Pos&, size_t, const std::vector<std::unique_ptr<Sim>>&);
+
+	// Resuming needs the configs of the checkpoint, in order; forking only their geometry (# of blocks,
+	// associativity, n_dw, destination mapping, window length), from one checkpointed Sim per Sim or a single
+	// one for all of them
+	Pos load(const std::string&, size_t, std::vector<std::unique_ptr<Sim>>&, bool);
+
+	// SimDriver::run with checkpoints; false if it stopped at the prefix. OPT replacement is not supported
+	bool run(const std::vector<std::string>&, const std::shared_ptr<AsmParser>&, std::vector<std::unique_ptr<Sim>>&, const Plan&);
+
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstdint>
+
+// Decompresses a gzip/xz file on a worker thread into a bounded queue of blocks
+class InflateStream {
+public:
+    enum class Fmt {
+        none,
+        gzip,
+        xz
+    };
+
+    // Detects the compression format from the leading bytes of the file
+    static Fmt detect(const std::string&);
+
+    explicit InflateStream(const std::string&, Fmt);
+    ~InflateStream();
+
+    InflateStream(const InflateStream&) = delete;
+    InflateStream & operator=(const InflateStream&) = delete;
+
+    // Blocking read of up to n bytes, returns 0 at end of stream
+    size_t read(char *, size_t);
+
+private:
+    static constexpr size_t blkSize = 4 << 20;
+    static constexpr size_t maxBlks = 4;
+
+    std::string file;
+    Fmt fmt;
+
+    std::thread worker;
+    std::mutex mtx;
+    std::condition_variable cvFull;
+    std::condition_variable cvEmpty;
+    std::deque<std::vector<char>> blks;
+    bool done;
+    bool stop;
+    std::exception_ptr err;
+
+    std::vector<char> cur;
+    size_t curPos;
+
+    void run();
+    void runGzip();
+    void runXz();
+    bool push(std::vector<char>&&);
+};
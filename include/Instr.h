@@ -3,6 +3,7 @@
 #include <iostream>
 #include <vector>
 #include <bitset>
+#include <utility>
 #include <ios>
 #include <cstdint>
 #include "Util.h"
@@ -11,33 +12,45 @@
 
 namespace sass {
 
+	// Decoded static SASS instruction, shared by all of its dynamic instances
+	struct StaticInstr {
+		uint32_t pc;
+		op::Opcode opcode;
+		std::vector<reg::Oprd> regPool;
+		std::bitset<4> reuseFlag;
+	};
+
+	// Dynamic instruction: a static instruction executed by one warp
 	struct Instr {		
 		Instr()=default;
 		Instr(
-			uint32_t pc, 
+			const StaticInstr * si,
 			std::bitset<32> mask,
 			util::Dim3<int> tbId,
-			uint32_t wId,
-			op::Opcode opcode,
-			std::vector<reg::Oprd> regPool,
-			std::bitset<4> reuseFlag
-		) : pc(pc), mask(mask), tbId(tbId), wId(wId), opcode(opcode), regPool(regPool), reuseFlag(reuseFlag) {}
+			uint32_t wId
+		) : si(si), mask(mask), tbId(tbId), wId(wId) {}
 
-		uint32_t pc;
+		const StaticInstr * si; // nullptr for VOID
 		std::bitset<32> mask;
 		util::Dim3<int> tbId;
 		uint32_t wId; // warp id
+		const uint32_t * nextUse = nullptr; // per operand, see NextUse::annotate (OPT replacement only)
 
-		op::Opcode opcode;	
-		std::vector<reg::Oprd> regPool;
-    	std::bitset<4> reuseFlag;
+		uint32_t pc() const noexcept { return si ? si->pc : 0; }
+		op::Opcode opcode() const noexcept { return si ? si->opcode : op::OP_VOID; }
+		std::bitset<4> reuseFlag() const noexcept { return si ? si->reuseFlag : std::bitset<4>(); }
+
+		const std::vector<reg::Oprd> & regPool() const noexcept {
+			static const std::vector<reg::Oprd> none;
+			return si ? si->regPool : none;
+		}
 	};
 
 	inline std::ostream & operator<<(std::ostream & os, const Instr & traceInst) {
 		auto & ins = traceInst;
-		os << ins.tbId << ", " << ins.wId << ", " << ins.pc << ", " << ins.mask << ", "
-				  << ins.reuseFlag << ", " << ins.opcode << ", <";
-		for (const auto & reg : ins.regPool) {
+		os << ins.tbId << ", " << ins.wId << ", " << ins.pc() << ", " << ins.mask << ", "
+				  << ins.reuseFlag() << ", " << ins.opcode() << ", <";
+		for (const auto & reg : ins.regPool()) {
 			os << reg << " ";
 		}
 		os << ">";
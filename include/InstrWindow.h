@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+#include "Instr.h"
+
+// Look-ahead window: a FIFO of instructions (same interface as the std::queue it replaces) that also
+// counts how often every register occurs in it, so "is this register used within the window?" is O(1)
+class InstrWindow {
+private:
+	static constexpr uint32_t nDirect = 1024; // register indices counted in a flat table
+
+	std::vector<sass::Instr> buf; // ring, capacity is a power of 2
+	size_t head = 0;
+	size_t n = 0;
+	std::vector<uint32_t> cnt = std::vector<uint32_t>(nDirect, 0);
+	std::unordered_map<uint32_t, uint32_t> farCnt; // indices >= nDirect (malformed traces)
+
+	void count(const sass::Instr & inst, int d) {
+		for (const auto & oprd : inst.regPool()) {
+			if (oprd.index < nDirect)
+				cnt[oprd.index] += d;
+			else if ((farCnt[oprd.index] += d) == 0)
+				farCnt.erase(oprd.index);
+		}
+	}
+
+	void grow() {
+		std::vector<sass::Instr> next(buf.empty() ? 16 : buf.size() * 2);
+		for (size_t i = 0; i < n; i++)
+			next[i] = buf[(head + i) & (buf.size() - 1)];
+		buf.swap(next);
+		head = 0;
+	}
+
+public:
+	size_t size() const noexcept { return n; }
+	bool empty() const noexcept { return n == 0; }
+	const sass::Instr & front() const { return buf[head]; }
+	const sass::Instr & at(size_t i) const { return buf[(head + i) & (buf.size() - 1)]; } // i-th oldest
+
+	void push(const sass::Instr & inst) {
+		if (n == buf.size())
+			grow();
+		buf[(head + n) & (buf.size() - 1)] = inst;
+		n++;
+		count(inst, 1);
+	}
+
+	void pop() {
+		count(buf[head], -1);
+		head = (head + 1) & (buf.size() - 1);
+		n--;
+	}
+
+	void clear() {
+		while (n)
+			pop();
+	}
+
+	void dropNextUse() noexcept {
+		for (size_t i = 0; i < n; i++)
+			buf[(head + i) & (buf.size() - 1)].nextUse = nullptr;
+	}
+
+	// # of operands (of any type) in the window naming the register
+	uint32_t uses(uint32_t index) const {
+		if (index < nDirect)
+			return cnt[index];
+		auto it = farCnt.find(index);
+		return it == farCnt.end() ? 0 : it->second;
+	}
+};
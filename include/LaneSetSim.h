@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Sim.h"
+
+class ThreadPool;
+
+// Lane- and set-decomposed engine for one Sim.
+// Each thread's CAM and each cache set of it evolve independently, and getCacheSet() only depends on the
+// operand, so the front end (look-ahead window, allocation decisions) runs serially and buffers the operands
+// of every warp slot per cache set; the buffered substreams are then simulated per (slot, set, lane group)
+// on a thread pool. Lane groups are whole cache banks, so bank transactions add up like the other counters.
+// Results are identical to Sim.
+class LaneSetSim {
+public:
+	explicit LaneSetSim(Sim&);
+
+	LaneSetSim(const LaneSetSim&) = delete;
+	LaneSetSim & operator=(const LaneSetSim&) = delete;
+
+	// Same as Sim::exec / Sim::endKernel
+	void exec(const sass::Instr&);
+	void endKernel();
+
+	// # of buffered operand accesses
+	size_t pending() const noexcept;
+
+	// Simulates the buffered accesses; pool.wait() must return before the next exec()
+	void submit(ThreadPool&);
+	void clear() noexcept;
+
+	// Writes the counters and the CAM state back to the Sim
+	void finish();
+
+private:
+	// One operand access of an executed instruction
+	struct Access {
+		int64_t t; // # of the instruction in its warp slot
+		uint32_t tag;
+		uint32_t lanes; // bit i: thread i is active
+		bool dst;
+		bool fill; // a miss takes a block
+	};
+
+	struct Entry {
+		uint32_t tag;
+		bool dt;
+		int64_t ts; // instruction that last set the age to 1 (age = 1 + t - ts)
+	};
+
+	Sim & sim;
+	uint32_t assoc;
+	uint32_t nSet;
+	uint32_t nLane; // threads per cache bank
+	uint32_t groupSize; // threads per task
+
+	std::vector<int64_t> t; // executed instructions per slot
+	std::vector<std::vector<Access>> accs; // per (slot, set)
+	std::vector<Entry> entries; // per (slot, set, lane, way)
+	std::vector<stat::Stat> shards; // per (slot, set, lane group)
+	size_t nPending;
+
+	void run(uint32_t, uint32_t, uint32_t);
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "Instr.h"
+#include "AsmParser.h"
+
+// Offline annotation for the OPT (Belady) replacement oracle
+namespace NextUse {
+
+	// One decoded kernel; every non-address operand is annotated with the # of instructions of its warp
+	// slot until the register is accessed again (0: never within the kernel)
+	struct Kernel {
+		std::vector<sass::Instr> insts;
+		std::vector<uint32_t> dist; // per operand, Instr::nextUse points into it
+
+		Kernel() = default;
+		Kernel(const Kernel&) = delete;
+		Kernel & operator=(const Kernel&) = delete;
+	};
+
+	// Reverse pass in O(# of operands); memory besides the annotation is O(32 x # of registers)
+	void annotate(std::vector<sass::Instr>&, std::vector<uint32_t>&);
+
+	// Decodes and annotates a kernel trace. The whole kernel is held in memory (40 bytes per instruction plus
+	// 4 per operand), as the reverse pass needs it and traces cannot be read backwards
+	void load(const std::string&, const std::shared_ptr<AsmParser>&, Kernel&);
+
+};
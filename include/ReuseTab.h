@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include <bitset>
+#include <cstdint>
+
+// Reuse flags of one kernel, stored densely by PC with 4 bits per instruction slot.
+// SASS instructions are 16 bytes apart, so the slot index is pc >> 4; a table that
+// sees an unaligned PC falls back to one slot per byte.
+struct ReuseTab {
+	std::vector<uint8_t> nib; // two slots per byte, low nibble first
+	uint32_t shift = 4;
+
+	void set(uint32_t pc, std::bitset<4> flags) {
+		if (pc & ((1u << shift) - 1))
+			relayout(0);
+		size_t slot = pc >> shift;
+		if (slot / 2 >= nib.size())
+			nib.resize(slot / 2 + 1, 0);
+		auto sh = (slot & 1) * 4;
+		nib[slot / 2] = (nib[slot / 2] & ~(0xf << sh)) | (flags.to_ulong() << sh);
+	}
+
+	// All-clear for PCs the kernel does not contain
+	std::bitset<4> get(uint32_t pc) const noexcept {
+		if (pc & ((1u << shift) - 1))
+			return std::bitset<4>();
+		size_t slot = pc >> shift;
+		if (slot / 2 >= nib.size())
+			return std::bitset<4>();
+		return std::bitset<4>((nib[slot / 2] >> ((slot & 1) * 4)) & 0xf);
+	}
+
+private:
+	void relayout(uint32_t newShift) {
+		ReuseTab t;
+		t.shift = newShift;
+		for (size_t slot = 0; slot < nib.size() * 2; slot++) {
+			auto flags = (nib[slot / 2] >> ((slot & 1) * 4)) & 0xf;
+			if (flags)
+				t.set(static_cast<uint32_t>(slot << shift), std::bitset<4>(flags));
+		}
+		*this = std::move(t);
+	}
+};
@@ -13,6 +13,7 @@
 #include "Alloc.h"
 #include "Stat.h"
 #include "Instr.h"
+#include "InstrWindow.h"
 
 struct CacheEntry {
 	CacheEntry();
@@ -27,30 +28,75 @@ struct CacheEntry {
 
 inline std::ostream & operator<<(std::ostream &, const CacheEntry&);
 
+// Structure-of-arrays CAM: entry i of thread tid is at [i * 32 + tid], so the 32 threads of an entry
+// are contiguous and a lookup compares one tag against the whole warp at once
 struct Cam {
 
-	explicit Cam(uint32_t assoc, uint32_t nBlk, uint32_t nDW) : assoc(assoc), nDW(nDW) {
-		for (auto & b : mem) b.resize(nBlk);
-		for (auto & b : vMem) b.resize(nBlk);
-	}
+	explicit Cam(uint32_t assoc, uint32_t nBlk, uint32_t nDW);
 
-	std::array<std::vector<CacheEntry>, 32> mem;
-	std::array<std::vector<CacheEntry>, 32> vMem;
+	std::vector<uint32_t> tag;
+	std::vector<uint32_t> ts; // clock of the last age reset: age = 1 + clock - ts (mod 2^32, as a wrapping counter)
+	std::vector<uint8_t> dt;
+	std::vector<uint32_t> memTag; // tags as of the last sync(), which lookups see
+	std::vector<uint32_t> log; // entries whose tag was set since the last sync()
 
 	uint32_t assoc;
+	uint32_t nBlk;
 	uint32_t nDW; 
+	uint32_t clock; // # of step() calls
 	
 	void flush();
 	void step();
 	void sync();
 
-	std::pair<bool, uint32_t> search(uint32_t, uint32_t, uint32_t);
+	// Threads holding the tag in the set (bit tid), idx[tid] is the matching entry
+	uint32_t search(uint32_t, uint32_t, std::array<uint32_t, 32>&) const;
+
+	uint32_t age(uint32_t e) const noexcept {
+		return 1 + clock - ts[e];
+	}
+
+	// Age of entry e back to 1
+	void touch(uint32_t e) noexcept {
+		ts[e] = clock;
+	}
+
+	CacheEntry entry(uint32_t tid, uint32_t i) const noexcept {
+		CacheEntry e;
+		e.set(tag[i * 32 + tid], age(i * 32 + tid), dt[i * 32 + tid]);
+		return e;
+	}
+
+	// Between instructions only (memTag == tag)
+	void copyColumn(uint32_t from, uint32_t to) noexcept {
+		for (uint32_t i = 0; i < nBlk; i++) {
+			tag[i * 32 + to] = tag[i * 32 + from];
+			ts[i * 32 + to] = ts[i * 32 + from];
+			dt[i * 32 + to] = dt[i * 32 + from];
+			memTag[i * 32 + to] = memTag[i * 32 + from];
+		}
+	}
+
+	void set(uint32_t tid, uint32_t i, uint32_t tag, uint32_t age, bool dt) {
+		if (this->tag[i * 32 + tid] != tag)
+			log.push_back(i * 32 + tid);
+		this->tag[i * 32 + tid] = tag;
+		this->ts[i * 32 + tid] = 1 + clock - age;
+		this->dt[i * 32 + tid] = dt;
+	}
 };
 
 inline std::ostream & operator<<(std::ostream &, const Cam&);
 
 struct BaseAllocator;
 
+// Outcome of moving the look-ahead window by one instruction
+enum class Slide {
+	warm, // buffered, nothing to execute
+	exec, // an instruction leaves the window
+	end // VOID on an empty window: the kernel is drained
+};
+
 struct Rfc{
 	std::shared_ptr<cfg::GlobalCfg> cfg; // configuration
 	std::shared_ptr<stat::Stat> scbBase; // scoreboard baseline
@@ -59,9 +105,27 @@ struct Rfc{
 	BaseAllocator * allocator;
 	
 	std::bitset<32> mask;
+	uint32_t lanes; // mask with bit tid for thread tid
 	std::bitset<4> flags;
-	std::queue<sass::Instr> iQueue; // Instruction Queue
+	InstrWindow iQueue; // Instruction Queue
 	std::array<std::bitset<32>, 4> simdBuf;
+	std::array<uint32_t, 32> hitIdx;
+	uint32_t bankLead; // first thread of every cache bank
+
+	// Simulation core specialized for the configured policies and geometry
+	using Kernel = void (Rfc::*)(const sass::Instr&);
+	Kernel kernel;
+	uint32_t dwShift; // log2(nDW)
+	uint32_t setShift; // log2(# of sets)
+
+	// OPT: tick (executed instruction) of the next access of every register of the warp slot
+	std::vector<uint64_t> regNext;
+	uint64_t tick;
+
+	// Lane folding: threads with identical histories have identical CAM columns, so only the lowest thread
+	// (leader) of each class is simulated and outcomes are scaled by the class; other columns are stale
+	uint32_t leaders;
+	std::array<uint32_t, 32> cls; // threads of the class led by tid
 	
 	
 	explicit Rfc(
@@ -72,20 +136,38 @@ struct Rfc{
 
 	~Rfc();
 
-	Rfc(const Rfc&); // copy constructor
+	Rfc(const Rfc&); // copy constructor, CAM contents and look-ahead window included
 
 	inline uint32_t bankTxCnt(const std::bitset<32>&);
 	uint32_t getCacheSet(const reg::Oprd&) noexcept;
 
-	std::pair<bool, uint32_t> search(const reg::Oprd&, uint32_t, uint32_t);
+	uint32_t search(const reg::Oprd&, uint32_t);
 	
 	void step() noexcept;
 	void sync();
+	void flush();
+	void refine(uint32_t);
+	void unfold();
+	uint32_t expand(uint32_t) const noexcept;
+	Slide slide(const sass::Instr&, sass::Instr&);
 	bool exec(const sass::Instr&);
 	void flushSimdBuf();
+	void noteUses(const sass::Instr&);
+	uint64_t blockNext(uint32_t) const noexcept;
 	
-	inline void hitHandler(const reg::Oprd&, uint32_t, uint32_t);
+	template <cfg::ReplPlcy, cfg::EvictPlcy>
+	void hitHandler(const reg::Oprd&, uint32_t);
+
+	template <cfg::DestMap, bool>
+	uint32_t cacheSet(const reg::Oprd&) const noexcept;
+
+	template <cfg::AllocPlcy, cfg::ReplPlcy, cfg::EvictPlcy, cfg::DestMap, bool>
+	void run(const sass::Instr&);
+
+	template <cfg::ReplPlcy, bool>
+	void fillLanes(const reg::Oprd&, uint32_t, uint32_t, bool);
 	
+	template <cfg::ReplPlcy>
 	std::pair<bool, uint32_t> replWrapper(uint32_t, uint32_t);
 	friend std::ostream & operator<<(std::ostream&, const Rfc&);
 };
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "AsmParser.h"
+#include "Sim.h"
+#include "SimPoint.h"
+
+// Statistical sampling (SMARTS-style). Every instruction is parsed, but only some reach the RFC:
+// - fast-forward: skipped, the CAM keeps its (stale) state;
+// - functional warming: before its first measured instruction after a skip, a warp slot replays the last
+//   instructions it skipped, with the counters discarded, to rebuild its CAM state;
+// - detailed: executed and counted per measurement unit.
+// Units are periodic intervals of the trace, randomly selected CTAs (cta), or the representative intervals of
+// SimPoint phases; with phases, only the representatives and their warm-ups are read, the reader seeking to them.
+// The baseline (MRF-only) counters are exact, as they only need the operands (with phases, they come from the
+// profile); every RFC counter is estimated as its per-unit ratio to the matching baseline counter (hits and MRF
+// reads to baseline reads, etc.) times the exact baseline, per phase with SimPoint phases (one unit each, so
+// without confidence intervals).
+namespace Sampling {
+
+	struct Plan {
+		double fraction = 1; // of the instructions (intervals), or of the CTAs, measured in detail
+		uint64_t unitLen = 8192; // instructions per measured interval
+		uint64_t warmLen = 64; // skipped instructions a warp slot replays to warm up
+		bool cta = false; // units are randomly selected CTAs
+		std::shared_ptr<const SimPoint::Phases> phases; // units are their representatives (fraction, unitLen, cta unused)
+		double margin = 0; // target half-width of the hit rates (percentage points), 0: none
+		uint64_t seed = 1;
+	};
+
+	// Ratio to the baseline counter, with the half-width of its 95% confidence interval
+	struct Ratio {
+		double value;
+		double halfWidth; // NaN with fewer than 2 units
+	};
+
+	struct Estimate {
+		size_t nUnit; // measured units
+		uint64_t nInst, nWarm, nDetail; // traced, replayed (per Sim) and measured instructions
+		Ratio rdHit, wrHit, mrfRd, mrfWr;
+	};
+
+	// Sampled counterpart of SimDriver::run; the Sims' scoreboards get the exact baseline and the estimated
+	// RFC counters. OPT replacement is not supported
+	std::vector<Estimate> run(
+		const std::vector<std::string>&,
+		const std::shared_ptr<AsmParser>&,
+		std::vector<std::unique_ptr<Sim>>&,
+		const Plan&
+	);
+
+	void report(std::ostream&, const Estimate&, const Plan&);
+
+};
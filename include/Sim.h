@@ -0,0 +1,75 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <deque>
+
+#include "CfgParser.h"
+#include "AsmParser.h"
+#include "Stat.h"
+#include "Rfc.h"
+
+// One simulated RFC configuration: a register file cache per warp slot and its scoreboards
+struct Sim {
+	std::shared_ptr<cfg::GlobalCfg> cfg;
+	std::shared_ptr<stat::Stat> scbBase; // scoreboard baseline
+	std::shared_ptr<stat::Stat> scb; // scoreboard
+	std::vector<Rfc> rfcArry;
+	bool kernelEnd; // the current kernel has been drained
+	std::deque<sass::StaticInstr> restored; // static instructions of the look-ahead windows restored from a checkpoint
+
+	explicit Sim(const std::shared_ptr<cfg::GlobalCfg>&);
+
+	Sim(const Sim&) = delete;
+	Sim & operator=(const Sim&) = delete;
+
+	void exec(const sass::Instr&);
+	void endKernel();
+	void drainAll();
+	void flush();
+
+	// Gives every warp slot its own scoreboards so that slots can be simulated concurrently;
+	// unshard() merges them back (the counters are integers, so the totals are exact)
+	void shard();
+	void unshard();
+
+	void report(std::ostream&) const;
+};
+
+// Element of the parser -> simulator ring
+struct TracePkt {
+	sass::Instr inst;
+	bool kernelEnd;
+};
+
+// Element of a router -> warp-slot worker ring
+struct SlotPkt {
+	sass::Instr inst;
+	uint32_t slot;
+	uint64_t simMask; // Sims that execute the instruction
+};
+
+namespace SimDriver {
+
+	// Parses each kernel once and feeds every Sim on the calling thread; with an OPT config, each kernel is
+	// decoded and annotated with next uses (NextUse) first. The other modes, except runKernelParallel, reject OPT
+	void run(const std::vector<std::string>&, const std::shared_ptr<AsmParser>&, std::vector<std::unique_ptr<Sim>>&);
+
+	// Parser thread broadcasts decoded instructions to one simulator thread per Sim
+	void runPipelined(const std::vector<std::string>&, const std::shared_ptr<AsmParser>&, std::vector<std::unique_ptr<Sim>>&);
+
+	// RFC state is flushed at kernel boundaries, so kernels are simulated concurrently on a thread pool;
+	// per-kernel statistics are merged in kernelslist order
+	void runKernelParallel(const std::vector<std::string>&, const std::shared_ptr<AsmParser>&, std::vector<std::unique_ptr<Sim>>&, size_t);
+
+	// Warp slots only share the scoreboards, so the parser routes each instruction to the worker owning its slot
+	// (slot % # of workers); results are identical to run()
+	void runSlotParallel(const std::vector<std::string>&, const std::shared_ptr<AsmParser>&, std::vector<std::unique_ptr<Sim>>&, size_t);
+
+	// Operand accesses are buffered per (warp slot, cache set) and simulated per lane group on a thread pool
+	// (see LaneSetSim); results are identical to run()
+	void runLaneSet(const std::vector<std::string>&, const std::shared_ptr<AsmParser>&, std::vector<std::unique_ptr<Sim>>&, size_t);
+
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "AsmParser.h"
+#include "TraceReader.h"
+
+// SimPoint-style phase analysis: the trace (all kernels, in order) is cut into fixed-length intervals, each
+// summarized by how often it executes every static instruction (a basic-block vector weighted by block size),
+// and the intervals are clustered into phases. One representative interval per phase is simulated
+// (Sampling), the others are extrapolated from it: the profile keeps the baseline MRF counters of every interval
+// and where each representative and its warm-up start, so that later runs only read those parts of the trace.
+namespace SimPoint {
+
+	struct Options {
+		uint64_t intervalLen = 100000; // instructions
+		uint64_t warmLen = 8192; // instructions before a representative read to warm it up
+		uint32_t maxPhases = 30;
+		uint32_t dims = 15; // of the random projection of the vectors
+		uint64_t seed = 1;
+	};
+
+	// Trace position: a mark of the reader of one kernel
+	struct Pos {
+		uint64_t kernel; // index in the kernel list
+		TraceMark mark;
+	};
+
+	struct Phases {
+		uint64_t intervalLen;
+		uint64_t warmLen; // at most intervalLen
+		uint64_t nInst; // of the trace
+		std::vector<uint64_t> traceSize; // bytes of every kernel trace, to tell a changed trace
+		std::vector<uint32_t> label; // phase of every interval
+		std::vector<uint64_t> baseRd, baseWr; // baseline MRF reads and writes of every interval
+		std::vector<uint64_t> rep; // representative interval of every phase
+		std::vector<double> weight; // share of the instructions of every phase
+		std::vector<Pos> warm, start; // of the warm-up and of the representative of every phase
+
+		uint64_t lenOf(uint64_t interval) const noexcept;
+		uint64_t warmOf(uint64_t interval) const noexcept; // # of instructions before it read to warm up
+
+		// Throws if the trace files are not the profiled ones
+		void check(const std::vector<std::string>&) const;
+
+		// Text file: "simpoints v2 <interval length> <warm-up length> <# of instructions> <# of kernels>
+		// <# of phases> <# of intervals>", the kernel trace sizes, one "<representative> <weight> <warm-up>
+		// <start>" line per phase, each position as "<kernel> <offset> <kernel offset> <# of defs> <CTA x y z>
+		// <warp> <pc>", then one "<label> <baseline reads> <baseline writes>" line per interval
+		void save(const std::string&) const;
+		void load(const std::string&);
+	};
+
+	// Profiling pass over the trace; the # of phases is the smallest whose BIC score reaches 90% of the
+	// range over 1..maxPhases (as SimPoint does)
+	Phases profile(const std::vector<std::string>&, const std::shared_ptr<AsmParser>&, const Options&);
+
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <cstdint>
+
+#include "CfgParser.h"
+#include "AsmParser.h"
+#include "Instr.h"
+
+// Single-pass hit-rate analysis of every RFC geometry (Mattson stack distances).
+// Each (warp slot, thread, cache set) of an LRU write-allocate cache is a stack. Read misses bypass the cache, so a
+// read hit refreshes a block only in the sizes holding it; the caches still nest (a block held in A ways is held
+// in more), and each stack entry records the smallest associativity holding it: an access hits in an A-way set
+// iff the entry holds it in A ways or fewer. A write takes a block in every size that misses, evicting the least
+// recent block held there. One pass per set count therefore covers every associativity; set counts are powers
+// of 2 up to a limit. Lookups see the stacks as of the start of the instruction, like Rfc::sync. Rfc still departs
+// from a stack when an instruction touches a (thread, set) several times: those blocks get equal ages, which Rfc
+// breaks by way index, and a hit on the snapshot refreshes whatever block an earlier operand left in that entry.
+// Every point is therefore an estimate; simulate the chosen points.
+namespace StackDist {
+
+	// Counters of one geometry
+	struct Point {
+		uint32_t nSet;
+		uint32_t assoc;
+		uint64_t rdHit, rdMiss, wrHit, wrMiss;
+		uint64_t mrfRd, mrfWr; // with the RFC; without it, every access goes to the MRF
+	};
+
+	class Analyzer {
+	public:
+		// Geometry-independent parameters (n_dw, dest_map, evict) come from the config
+		Analyzer(const cfg::GlobalCfg&, uint32_t maxSet, uint32_t maxAssoc);
+
+		// Instructions in trace order; VOID ends a kernel
+		void exec(const sass::Instr&);
+
+		// Counters of every (# of sets, associativity), # of sets major
+		std::vector<Point> results();
+
+	private:
+		// Per set count: LRU stacks of every (slot, thread, set), holding the blocks of the largest associativity
+		// (the others miss in every tracked geometry), and histograms of the smallest associativity holding them
+		struct Level {
+			uint32_t nSet;
+			std::vector<uint32_t> n; // # of blocks per stack
+			std::vector<uint32_t> tag; // per (stack, depth - 1)
+			std::vector<uint32_t> hold; // per (stack, depth - 1): smallest associativity holding the block
+			std::vector<uint32_t> dirty; // per (stack, depth - 1): dirty in sets of fewer than dirty ways
+			std::vector<uint64_t> rd, wr; // accesses per smallest associativity, [maxAssoc + 1] = none
+			std::vector<uint64_t> wb; // writebacks per associativity
+		};
+
+		cfg::GlobalCfg cfg;
+		uint32_t maxAssoc;
+		std::vector<Level> levels;
+		std::vector<uint32_t> holds; // of the accesses of the current instruction
+		std::vector<uint32_t> cnt; // blocks seen per associativity, while evicting
+
+		uint32_t holdOf(const Level&, size_t, uint32_t) const noexcept;
+		void access(Level&, size_t, uint32_t, bool, uint32_t);
+	};
+
+	// Feeds every kernel of the trace list to the analyzer
+	void run(const std::vector<std::string>&, const std::shared_ptr<AsmParser>&, Analyzer&);
+
+	// One row per geometry: n_block=..,assoc=..;rdHit%;wrHit%;totHit%;mrfRdReduction%;mrfWrReduction%;mrfRd;mrfWr
+	void log(std::ofstream&, const std::vector<Point>&);
+
+};
@@ -41,6 +41,7 @@ namespace stat {
         void trigger(Event, uint32_t) noexcept;
         
         void clear() noexcept;
+        void merge(const Stat&) noexcept;
         float calcRfEngy() const;
 
         static void printCmp(const Stat &, const Stat&);
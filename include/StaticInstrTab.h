@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+
+#include "Instr.h"
+
+// Interned static instructions of a run, keyed by (kernel, PC, reader-specific key).
+// Entries are never moved or freed while the table lives, so dynamic instructions
+// refer to them by pointer. Shared by all trace readers; interning is thread-safe.
+class StaticInstrTab {
+private:
+    mutable std::mutex mtx;
+    std::deque<sass::StaticInstr> instrs;
+    std::unordered_map<std::string, const sass::StaticInstr *> index;
+
+public:
+    // Returns the entry of (kernel, pc, key), decoding it with make() on first use
+    template <typename F>
+    const sass::StaticInstr * intern(const std::string & kernel, uint32_t pc, std::string_view key, F && make) {
+        std::string k;
+        k.reserve(kernel.size() + key.size() + 5);
+        k.append(kernel).push_back('\0');
+        k.append(reinterpret_cast<const char *>(&pc), sizeof(pc));
+        k.append(key);
+
+        std::lock_guard<std::mutex> lk(mtx);
+        auto it = index.find(k);
+        if (it != index.end())
+            return it->second;
+
+        instrs.push_back(make());
+        const sass::StaticInstr * si = &instrs.back();
+        index.emplace(std::move(k), si);
+        return si;
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lk(mtx);
+        return instrs.size();
+    }
+};
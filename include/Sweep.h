@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <fstream>
+
+#include "CfgParser.h"
+#include "AsmParser.h"
+#include "Instr.h"
+
+// Design-space sweep: a base config and a grid of parameter values, simulated as (config x kernel) tasks
+namespace Sweep {
+
+	// One point of the grid
+	struct Point {
+		std::vector<std::pair<std::string, std::string>> params; // swept key -> value
+		std::shared_ptr<cfg::GlobalCfg> cfg;
+	};
+
+	// The grid file maps config keys (assoc, n_block, n_dw, bitwidth, window_len, arch, alloc, repl, evict,
+	// dest_map) to lists of values; every combination is expanded, the last key varying fastest
+	std::vector<Point> expand(const std::string&, const std::string&);
+
+	// Decoded instructions of every kernel, shared read-only by all tasks; annotated with next uses if asked
+	// (OPT replacement)
+	struct TraceSet {
+		std::vector<std::vector<sass::Instr>> kernels;
+		std::vector<std::vector<uint32_t>> nextUse;
+
+		TraceSet(const std::vector<std::string>&, const std::shared_ptr<AsmParser>&, size_t, bool = false);
+	};
+
+	// Whether any point needs a next-use annotated TraceSet
+	bool needsNextUse(const std::vector<Point>&);
+
+	// Kernels are independent (the RFC starts cold on each), statistics are merged in kernelslist order;
+	// writes one log row per point
+	void run(const std::vector<Point>&, const TraceSet&, size_t, std::ofstream&);
+
+};
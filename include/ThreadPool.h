@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+// Fixed-size work-stealing pool: each worker owns a task deque, runs its newest task first and
+// steals the oldest task of another worker when its own deque is empty.
+// Tasks receive the index of the worker running them, so callers can keep per-worker state.
+class ThreadPool {
+public:
+    using Task = std::function<void(size_t)>;
+
+    explicit ThreadPool(size_t);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool & operator=(const ThreadPool&) = delete;
+
+    size_t size() const noexcept;
+
+    // From a worker the task goes to its own deque, otherwise the deques are filled round-robin
+    void submit(Task);
+
+    // Blocks until every submitted task has finished, rethrows the first task error
+    void wait();
+
+    // Number of workers to use when none is requested
+    static size_t defaultSize() noexcept;
+
+private:
+    struct alignas(64) Queue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<size_t> nQueued;
+    std::atomic<size_t> nextQueue;
+
+    std::mutex mtx; // guards sleeping, nPending and err
+    std::condition_variable cvTask;
+    std::condition_variable cvIdle;
+    size_t nPending; // queued + running
+    bool stop;
+    std::exception_ptr err;
+
+    bool pop(size_t, Task&);
+    void run(size_t);
+};
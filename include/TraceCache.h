@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "AsmParser.h"
+
+// On-disk cache of decoded inputs shared across runs.
+// Text kernel traces are stored in the binary trace format (memory-mapped on later runs),
+// cuobjdump reuse tables in a flat table file. Entries are keyed by the path, size and
+// mtime of their input, so an edited input simply misses.
+class TraceCache {
+private:
+    std::string dir;
+
+    std::string entry(const std::string&, const char *) const;
+    static void commit(const std::string&, const std::string&);
+
+public:
+    explicit TraceCache(const std::string&);
+
+    // Path of the decoded trace to simulate, converting the text trace on a miss
+    std::string trace(const std::string&);
+
+    // Fills the reuse tables from the cache, false on a miss
+    bool loadAsm(const std::string&, AsmParser&) const;
+    void saveAsm(const std::string&, const AsmParser&) const;
+};
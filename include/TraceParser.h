@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -9,6 +10,9 @@
 
 #include "Instr.h"
 #include "AsmParser.h"
+#include "TraceReader.h"
+#include "StaticInstrTab.h"
+#include "Inflate.h"
 
 struct KernelInfo {
 	KernelInfo() {}
@@ -30,40 +34,69 @@ inline std::ostream & operator<< (std::ostream & os, const KernelInfo & info) {
 	return os;
 }
 
-class TraceParser {
+class TraceParser : public BaseTraceReader {
 private:
-    using mapT = std::unordered_map<uint32_t, std::bitset<4>>;
-    
-    std::ifstream traceIfs;
-    std::ifstream lAheadIfs;
+    // The trace is scanned in large blocks; tokens are views into buf
+    static constexpr size_t blkSize = 4 << 20;
+
+    std::string traceFile;
+    int traceFd;
+    std::unique_ptr<InflateStream> inflate; // set for gzip/xz traces
+    std::vector<char> buf;
+    uint64_t bufOff; // file offset of buf[0]
+    size_t lineBeg; // start of the next unread line
+    size_t dataEnd; // end of valid data in buf
+    bool srcEof;
+
+    std::vector<std::string_view> toks;
 
 	KernelInfo kernelInfo;
-    
-    std::shared_ptr<std::vector<mapT>> reuseInfo;
-    std::shared_ptr<std::unordered_map<std::string, size_t>> map;
+
+    std::shared_ptr<AsmParser> asmParser;
+    const ReuseTab * reuseTab; // resolved at the kernel header
+    uint64_t kernelOff; // of the kernel header line
+
+    // Static instructions of the current kernel seen by this parser: pc -> (static key, entry)
+    std::shared_ptr<StaticInstrTab> sTab;
+    std::unordered_map<uint32_t, std::vector<std::pair<std::string, const sass::StaticInstr *>>> siCache;
+    std::string siKey;
 
     util::Dim3<int> blockId;
-    unsigned wId; 
+    unsigned wId;
+
+    void open(const std::string&);
+    void close() noexcept;
+    bool fill();
+    bool nextLine(std::string_view&);
+    void tokenize(std::string_view);
+    void moveTo(uint64_t);
+    void enterKernel(std::string_view);
 
 public:
 	explicit TraceParser(
-        const std::string &, 
-        const std::shared_ptr<std::vector<mapT>>&,
-        const std::shared_ptr<std::unordered_map<std::string, size_t>>&
+        const std::string &,
+        const std::shared_ptr<AsmParser>&
     );
- 
-    bool eof() const;
-    void reset(const std::string&);
-    bool isOprd(const std::string&) const;
-    bool IsAddrOprd(const std::string&) const;
-    reg::Oprd parseReg(const std::string&, reg::OprdT, uint32_t) const;
-    
-    bool isInst(const std::vector<std::string>&) const;
-    op::Opcode parseOpcode(const std::string&) const noexcept;
+    ~TraceParser();
+
+    TraceParser(const TraceParser&) = delete;
+    TraceParser & operator=(const TraceParser&) = delete;
+
+    bool eof() const override;
+    void reset(const std::string&) override;
+    const KernelInfo & info() const noexcept;
+    bool isOprd(std::string_view) const noexcept;
+    bool IsAddrOprd(std::string_view) const noexcept;
+    reg::Oprd parseReg(std::string_view, reg::OprdT, uint32_t) const;
+
+    bool isInst(const std::vector<std::string_view>&) const noexcept;
+    op::Opcode parseOpcode(std::string_view) const noexcept;
 
     void extendHmmaRegs(std::vector<reg::Oprd>&) const;
     void extendImmaRegs(std::vector<reg::Oprd>&) const;
-    sass::Instr parseInst(const std::vector<std::string> &);
-    sass::Instr parse();
+    sass::StaticInstr decodeInst(const std::vector<std::string_view> &, uint32_t) const;
+    sass::Instr parseInst(const std::vector<std::string_view> &);
+    sass::Instr parse() override;
+    TraceMark mark() const override;
+    void seek(const TraceMark&) override;
 };
-
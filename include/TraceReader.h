@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <bitset>
+
+#include "Instr.h"
+#include "ReuseTab.h"
+
+struct AsmParser;
+
+// Position of a reader between two parse() calls: the offset of the next record in the (uncompressed) file and
+// the state the headers before it leave (kernel record, CTA, warp)
+struct TraceMark {
+    static constexpr uint64_t noKernel = ~0ull;
+
+    uint64_t off = 0; // 0: start of the file
+    uint64_t kernelOff = noKernel; // of the kernel record in effect
+    uint64_t nDef = 0; // binary traces: records defined before off
+    util::Dim3<int> blockId = util::Dim3<int>(0, 0, 0);
+    uint32_t wId = 0;
+    uint32_t pc = 0; // binary traces: base of the next PC delta
+};
+
+// Common interface of the trace front ends (NVBit text traces, binary traces)
+struct BaseTraceReader {
+    virtual ~BaseTraceReader() = default;
+
+    virtual bool eof() const = 0;
+    virtual void reset(const std::string&) = 0;
+    virtual sass::Instr parse() = 0;
+
+    // Resuming at a mark taken on a reader of the same file skips everything before it; compressed text traces
+    // are still inflated up to the mark
+    virtual TraceMark mark() const = 0;
+    virtual void seek(const TraceMark&) = 0;
+};
+
+struct TraceReaderFactory {
+    // Picks the front end from the leading bytes of the file; without an AsmParser no reuse flags are set
+    static std::unique_ptr<BaseTraceReader> getInstance(
+        const std::string&,
+        const std::shared_ptr<AsmParser>&
+    );
+};
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <iostream>
+#include <string_view>
+#include <cctype>
+#include <cstdint>
 
 namespace util {
 	
@@ -19,5 +22,57 @@ namespace util {
 			std::cout << "(" << dim3.x << ", " << dim3.y << ", " << dim3.z << ")";
 			return os;	
 	}
-};
 
+	// Same acceptance rules as std::stoi, without exceptions or allocation
+	inline bool parseInt(std::string_view s, int & v) noexcept {
+		size_t i = 0;
+		while (i < s.size() && std::isspace(static_cast<unsigned char>(s[i])))
+			i++;
+
+		bool neg = false;
+		if (i < s.size() && (s[i] == '+' || s[i] == '-'))
+			neg = s[i++] == '-';
+
+		size_t first = i;
+		int64_t acc = 0;
+		while (i < s.size() && s[i] >= '0' && s[i] <= '9') {
+			acc = acc * 10 + (s[i] - '0');
+			if (acc > static_cast<int64_t>(INT32_MAX) + 1)
+				return false;
+			i++;
+		}
+		if (i == first)
+			return false;
+
+		acc = neg ? -acc : acc;
+		if (acc > INT32_MAX || acc < INT32_MIN)
+			return false;
+		v = static_cast<int>(acc);
+		return true;
+	}
+
+	// Same acceptance rules as `iss >> std::hex`, for the unsigned values in traces
+	inline bool parseHex(std::string_view s, uint64_t & v) noexcept {
+		size_t i = 0;
+		while (i < s.size() && std::isspace(static_cast<unsigned char>(s[i])))
+			i++;
+		if (i + 1 < s.size() && s[i] == '0' && (s[i + 1] == 'x' || s[i + 1] == 'X'))
+			i += 2;
+
+		size_t first = i;
+		uint64_t acc = 0;
+		for (; i < s.size(); i++) {
+			char c = s[i];
+			uint64_t d;
+			if (c >= '0' && c <= '9') d = c - '0';
+			else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+			else break;
+			acc = (acc << 4) | d;
+		}
+		if (i == first)
+			return false;
+		v = acc;
+		return true;
+	}
+};
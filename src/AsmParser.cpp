@@ -1,98 +1,293 @@
 #include "AsmParser.h"
+#include "ThreadPool.h"
 
-AsmParser::AsmParser() {}
+#include <string_view>
+#include <deque>
+#include <algorithm>
+
+AsmParser::AsmParser() : sTab(std::make_shared<StaticInstrTab>()) {}
 
 AsmParser::AsmParser(
     	const std::string & asmFile,
-    	const std::shared_ptr<std::vector<mapT>>& tab,
+    	const std::shared_ptr<std::vector<ReuseTab>>& tab,
 		const std::shared_ptr<std::unordered_map<std::string, size_t>>& map
-    ) : tab(tab), map(map) {
+    ) : tab(tab), map(map), sTab(std::make_shared<StaticInstrTab>()) {
     asmIfs = std::make_shared<std::ifstream>(asmFile);
 }
 
-void AsmParser::parse() {
-	if (!asmIfs->is_open())
-		return;
+namespace {
 
-	size_t idx = 0;
-	std::string kernel;
-    
-	while(!asmIfs->eof()) {
-		std::string line_s;
-		std::getline(*asmIfs, line_s);
-		if(line_s.empty()) 
-			continue;
-		
-		std::stringstream ss(line_s);
-		std::vector<std::string> toks;
-		std::string tok;
-
-		while(std::getline(ss, tok, ' '))
-			toks.push_back(tok);
-		
-		for (auto i = 0; i < toks.size(); i++) {
-			if (toks.at(i) == "\t\tFunction") {
-				kernel = toks.at(i + 2);
-				map->insert(std::pair<std::string, size_t>(kernel, idx));
-				tab->push_back(mapT());
-				idx++;
-				break;
+	bool isHex(char c) noexcept {
+		return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+	}
+
+	uint32_t hexVal(std::string_view s) noexcept {
+		uint32_t v = 0;
+		for (char c : s)
+			v = (v << 4) | (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+		return v;
+	}
+
+	// Leftmost "/*XXXX*/" (4 hex digits), as regex_search would find it
+	bool findPc(std::string_view tok, uint32_t & pc) noexcept {
+		for (size_t p = 0; p + 8 <= tok.size(); p++) {
+			if (tok[p] != '/' || tok[p + 1] != '*' || tok[p + 6] != '*' || tok[p + 7] != '/')
+				continue;
+			auto hex = tok.substr(p + 2, 4);
+			if (std::all_of(hex.begin(), hex.end(), isHex)) {
+				pc = hexVal(hex);
+				return true;
 			}
 		}
-		if (toks.size() < 10)
-			continue;
+		return false;
+	}
 
-		// Regex to detect input pattern
-		std::regex inst1st_regex("/\\*([0-9A-Fa-f]{4})\\*/");
-		std::regex inst2nd_regex("0x([0-9A-Fa-f]{16})");
-		std::smatch matches;
-         
-		if(std::regex_search(toks[8], matches, inst1st_regex)) {
-			std::string pc_s;
-			std::string flag_s;
-			uint32_t pc;
+	// Leftmost "0x" followed by 16 hex digits; returns the top byte of the control word
+	bool findCtrl(std::string_view tok, uint32_t & ctrl) noexcept {
+		for (size_t p = 0; p + 18 <= tok.size(); p++) {
+			if (tok[p] != '0' || tok[p + 1] != 'x')
+				continue;
+			auto hex = tok.substr(p + 2, 16);
+			if (std::all_of(hex.begin(), hex.end(), isHex)) {
+				ctrl = hexVal(hex.substr(0, 2));
+				return true;
+			}
+		}
+		return false;
+	}
 
-			try {
-				pc_s = matches[0].str().substr(2, 4);
-				std::stringstream pc_ss(pc_s);
-				pc_ss >> std::hex >> pc; 
-			} catch (std::exception & e) {
-				std::cerr << e.what() << std::endl;
+	// Splits on single spaces like std::getline(ss, tok, ' ')
+	void tokenize(std::string_view line, std::vector<std::string_view> & toks) {
+		toks.clear();
+		size_t start = 0;
+		while (start < line.size()) {
+			size_t pos = line.find(' ', start);
+			if (pos == std::string_view::npos) {
+				toks.push_back(line.substr(start));
+				break;
 			}
+			toks.push_back(line.substr(start, pos - start));
+			start = pos + 1;
+		}
+	}
+
+	bool nextLine(std::string_view text, size_t & pos, std::string_view & line) noexcept {
+		if (pos >= text.size())
+			return false;
+		size_t end = text.find('\n', pos);
+		if (end == std::string_view::npos)
+			end = text.size();
+		line = text.substr(pos, end - pos);
+		pos = end + 1;
+		return true;
+	}
+
+	const std::string_view funcTok = "\t\tFunction";
 
-			std::getline(*asmIfs, line_s);
-			toks.clear();
-			toks.resize(0);
-
-			ss = std::stringstream(line_s);
-			while(std::getline(ss, tok, ' '))
-				toks.push_back(tok);
-
-            if(std::regex_search(toks[toks.size() - 2], matches, inst2nd_regex)) {
-				flag_s = matches[0].str().substr(2, 2); // e.g., for a 0x080fe2..., extract 08
-				
-				uint32_t flag_ui;
-				std::stringstream flag_ss(flag_s);
-				flag_ss >> std::hex >> flag_ui;
-			
-				std::bitset<8> ctrl_flags(flag_ui);
-                std::bitset<4> flags(ctrl_flags.to_string().substr(2, 4));
-	   			
-				bool f0 = flags.test(0);
-				bool f1 = flags.test(1);
-				bool f2 = flags.test(2);
-				bool f3 = flags.test(3);
-
-				flags.set(0, f3);
-				flags.set(1, f2);
-				flags.set(2, f1);
-				flags.set(3, f0);
-                (tab->at(idx - 1)).insert(std::make_pair(std::move(pc), std::move(flags)));
+	struct Func {
+		std::string name;
+		ReuseTab tab;
+	};
+
+	// Parses a piece of the dump; returns false if it ends on an instruction whose control word
+	// is in the next piece
+	bool scan(std::string_view text, std::deque<Func> & funcs) {
+		std::vector<std::string_view> toks;
+		std::string_view line;
+		size_t pos = 0;
+
+		while (nextLine(text, pos, line)) {
+			if (line.empty())
+				continue;
+			tokenize(line, toks);
+
+			for (size_t i = 0; i < toks.size(); i++) {
+				if (toks[i] == funcTok) {
+					funcs.push_back(Func{std::string(toks.at(i + 2)), ReuseTab()});
+					break;
+				}
 			}
-			else 
+			if (toks.size() < 10)
+				continue;
+
+			uint32_t pc;
+			if (!findPc(toks[8], pc))
+				continue;
+
+			// The control word (and its reuse bits) is on the following line
+			if (!nextLine(text, pos, line))
+				return false;
+			tokenize(line, toks);
+
+			uint32_t ctrl;
+			if (toks.size() < 2 || !findCtrl(toks[toks.size() - 2], ctrl) || funcs.empty())
 				throw std::runtime_error("Runtime error: failed to parse asm file.\n");
+
+			// Reuse bits b5..b2 of the top byte map to flags 0..3
+			std::bitset<4> flags;
+			flags.set(0, ctrl & 0x20);
+			flags.set(1, ctrl & 0x10);
+			flags.set(2, ctrl & 0x08);
+			flags.set(3, ctrl & 0x04);
+			funcs.back().tab.set(pc, flags);
 		}
-		else 
+		return true;
+	}
+
+	// Start offsets of the lines that open a function
+	std::vector<size_t> funcStarts(std::string_view text) {
+		std::vector<size_t> starts;
+		size_t pos = 0;
+		while ((pos = text.find(funcTok, pos)) != std::string_view::npos) {
+			size_t end = pos + funcTok.size();
+			bool tokBeg = pos == 0 || text[pos - 1] == ' ' || text[pos - 1] == '\n';
+			bool tokEnd = end == text.size() || text[end] == ' ' || text[end] == '\n';
+			if (tokBeg && tokEnd) {
+				auto lineBeg = text.rfind('\n', pos);
+				lineBeg = lineBeg == std::string_view::npos ? 0 : lineBeg + 1;
+				if (starts.empty() || starts.back() != lineBeg)
+					starts.push_back(lineBeg);
+			}
+			pos = end;
+		}
+		return starts;
+	}
+
+}; // namespace
+
+AsmParser::~AsmParser() {
+	if (indexed.valid())
+		indexed.wait();
+}
+
+void AsmParser::load() {
+	asmIfs->seekg(0, std::ios::end);
+	text.resize(static_cast<size_t>(asmIfs->tellg()));
+	asmIfs->seekg(0, std::ios::beg);
+	asmIfs->read(text.data(), text.size());
+}
+
+void AsmParser::parse() {
+	if (!asmIfs->is_open())
+		return;
+	load();
+	parseText();
+}
+
+// Functions are independent, so the dump is split at function boundaries and parsed in parallel
+void AsmParser::parseText() {
+	std::string_view text(this->text);
+
+	// piece 0 is everything before the first function
+	auto starts = funcStarts(text);
+	starts.insert(starts.begin(), 0);
+	std::vector<std::deque<Func>> pieces(starts.size());
+	std::vector<char> complete(starts.size(), 1);
+
+	{
+		ThreadPool pool(std::min(ThreadPool::defaultSize(), starts.size()));
+		for (size_t i = 0; i < starts.size(); i++) {
+			pool.submit([&, i](size_t) {
+				size_t end = i + 1 < starts.size() ? starts[i + 1] : text.size();
+				complete[i] = scan(text.substr(starts[i], end - starts[i]), pieces[i]);
+			});
+		}
+		pool.wait();
+	}
+
+	if (!complete.back())
+		throw std::runtime_error("Runtime error: failed to parse asm file.\n");
+
+	// A control word on a "Function" line belongs to the previous function: rare enough to rescan serially
+	if (std::find(complete.begin(), complete.end(), 0) != complete.end()) {
+		pieces.assign(1, std::deque<Func>());
+		scan(text, pieces[0]);
+	}
+
+	size_t idx = tab->size();
+	for (auto & piece : pieces) {
+		for (auto & f : piece) {
+			map->insert(std::pair<std::string, size_t>(f.name, idx));
+			tab->push_back(std::move(f.tab));
+			idx++;
+		}
+	}
+	lazy = false;
+}
+
+void AsmParser::index() {
+	if (!asmIfs->is_open())
+		return;
+	load();
+	std::string_view text(this->text);
+	auto starts = funcStarts(text);
+
+	// Instructions before the first function, or a "Function" line right after an instruction line
+	// (read as its control word), are left to the full parser, which reproduces them exactly
+	std::deque<Func> preamble;
+	bool eager = !scan(text.substr(0, starts.empty() ? text.size() : starts[0]), preamble);
+	std::vector<std::string_view> toks;
+	for (auto s : starts) {
+		if (eager || s == 0)
 			continue;
-	}		
+		auto prevBeg = s >= 2 ? text.rfind('\n', s - 2) : std::string_view::npos;
+		prevBeg = prevBeg == std::string_view::npos ? 0 : prevBeg + 1;
+		tokenize(text.substr(prevBeg, s - 1 - prevBeg), toks);
+		uint32_t pc;
+		eager = toks.size() >= 10 && findPc(toks[8], pc);
+	}
+	if (eager) {
+		parseText();
+		return;
+	}
+
+	base = tab->size();
+	spans.clear();
+	for (size_t i = 0; i < starts.size(); i++) {
+		size_t end = i + 1 < starts.size() ? starts[i + 1] : text.size();
+		spans.emplace_back(starts[i], end);
+
+		auto lineEnd = text.find('\n', starts[i]);
+		if (lineEnd == std::string_view::npos)
+			lineEnd = text.size();
+		tokenize(text.substr(starts[i], lineEnd - starts[i]), toks);
+		for (size_t j = 0; j < toks.size(); j++) {
+			if (toks[j] == funcTok) {
+				map->insert(std::pair<std::string, size_t>(std::string(toks.at(j + 2)), base + i));
+				break;
+			}
+		}
+	}
+	tab->resize(base + spans.size());
+	once.reset(new std::once_flag[spans.size()]);
+	lazy = true;
+}
+
+// Indexing overlaps with opening the first trace; find() waits for it
+void AsmParser::indexAsync() {
+	indexed = std::async(std::launch::async, &AsmParser::index, this).share();
+}
+
+void AsmParser::decode(size_t idx) {
+	std::call_once(once[idx - base], [&] {
+		auto span = spans.at(idx - base);
+		std::deque<Func> funcs;
+		if (!scan(std::string_view(text).substr(span.first, span.second - span.first), funcs))
+			throw std::runtime_error("Runtime error: failed to parse asm file.\n");
+		(*tab)[idx] = std::move(funcs.front().tab);
+	});
+}
+
+const ReuseTab * AsmParser::find(const std::string & kernel) {
+	if (indexed.valid()) {
+		auto f = indexed;
+		f.get(); // rethrows indexing errors
+	}
+
+	auto it = map->find(kernel);
+	if (it == map->end())
+		return nullptr;
+	if (lazy && it->second >= base)
+		decode(it->second);
+	return &tab->at(it->second);
 }
@@ -0,0 +1,433 @@
+#include "BinTrace.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static void putVarint(std::string & buf, uint64_t v) {
+    while (v >= 0x80) {
+        buf.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    buf.push_back(static_cast<char>(v));
+}
+
+static void putZigzag(std::string & buf, int64_t v) {
+    putVarint(buf, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+static void putU32(std::string & buf, uint32_t v) {
+    for (auto i = 0; i < 4; i++)
+        buf.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+namespace bt {
+
+    bool isBinTrace(const std::string & file) {
+        std::ifstream ifs(file, std::ios::binary);
+        char head[sizeof(magic)];
+        if (!ifs.read(head, sizeof(head)))
+            return false;
+        return std::memcmp(head, magic, sizeof(magic)) == 0;
+    }
+
+};
+
+// ============================================== Writer ===============================
+BinTraceWriter::BinTraceWriter(const std::string & traceFile)
+    : wId(0), pc(0), hasKernel(false), hasBlock(false), hasWarp(false) {
+    traceOfs.open(traceFile, std::ios::binary | std::ios::trunc);
+    if (!traceOfs.is_open())
+        throw std::runtime_error("Runtime error: failed to create binary trace file.\n");
+
+    buf.append(bt::magic, sizeof(bt::magic));
+    putU32(buf, bt::version);
+    putU32(buf, 0);
+}
+
+BinTraceWriter::~BinTraceWriter() {
+    if (traceOfs.is_open())
+        close();
+}
+
+void BinTraceWriter::flush() {
+    traceOfs.write(buf.data(), buf.size());
+    buf.clear();
+}
+
+void BinTraceWriter::write(const std::string & sym, const sass::Instr & inst) {
+    if (!hasKernel || sym != kernelSym) {
+        kernelSym = sym;
+        buf.push_back(static_cast<char>(bt::RecT::kernel));
+        putVarint(buf, sym.size());
+        buf.append(sym);
+        hasKernel = true;
+        hasBlock = false;
+    }
+
+    if (!hasBlock || inst.tbId.x != blockId.x || inst.tbId.y != blockId.y || inst.tbId.z != blockId.z) {
+        blockId = inst.tbId;
+        buf.push_back(static_cast<char>(bt::RecT::cta));
+        putZigzag(buf, blockId.x);
+        putZigzag(buf, blockId.y);
+        putZigzag(buf, blockId.z);
+        hasBlock = true;
+        hasWarp = false;
+    }
+
+    if (!hasWarp || inst.wId != wId) {
+        wId = inst.wId;
+        buf.push_back(static_cast<char>(bt::RecT::warp));
+        putVarint(buf, wId);
+        pc = 0;
+        hasWarp = true;
+    }
+
+    // Intern the static part of the instruction
+    std::string key;
+    putVarint(key, inst.opcode());
+    putVarint(key, inst.regPool().size());
+    for (const auto & oprd : inst.regPool()) {
+        key.push_back(static_cast<char>(oprd.type));
+        putVarint(key, oprd.index);
+        putVarint(key, oprd.pos);
+        putVarint(key, oprd.set);
+    }
+
+    auto it = recTab.find(key);
+    if (it == recTab.end()) {
+        it = recTab.emplace(key, static_cast<uint32_t>(recTab.size())).first;
+        buf.push_back(static_cast<char>(bt::RecT::def));
+        buf.append(key);
+    }
+
+    buf.push_back(static_cast<char>(bt::RecT::inst));
+    putZigzag(buf, static_cast<int64_t>(inst.pc()) - static_cast<int64_t>(pc));
+    putU32(buf, static_cast<uint32_t>(inst.mask.to_ulong()));
+    putVarint(buf, it->second);
+    pc = inst.pc();
+
+    if (buf.size() >= (1 << 20))
+        flush();
+}
+
+void BinTraceWriter::close() {
+    buf.push_back(static_cast<char>(bt::RecT::end));
+    flush();
+    traceOfs.close();
+    if (traceOfs.fail())
+        throw std::runtime_error("Runtime error: failed to write binary trace file.\n");
+}
+
+uint64_t BinTraceWriter::convert(const std::string & src, const std::string & dst) {
+    TraceParser parser(src, nullptr);
+    BinTraceWriter writer(dst);
+
+    uint64_t n = 0;
+    while (true) {
+        auto inst = parser.parse();
+        if (inst.opcode() == op::OP_VOID)
+            break;
+        writer.write(parser.info().kernelSym, inst);
+        n++;
+    }
+    writer.close();
+    return n;
+}
+
+// ============================================== Reader ===============================
+BinTraceReader::BinTraceReader(
+    const std::string & traceFile,
+    const std::shared_ptr<AsmParser> & asmParser
+) : base(nullptr), size(0), cur(nullptr), done(true), asmParser(asmParser), reuseTab(nullptr), kernelOff(TraceMark::noKernel), blockId(0, 0, 0), wId(0), pc(0),
+    nDef(0), scanOff(bt::headerSize) {
+    if (asmParser)
+        sTab = asmParser->sTab;
+    else
+        sTab = std::make_shared<StaticInstrTab>(); // private table, valid while the reader lives
+    open(traceFile);
+}
+
+BinTraceReader::~BinTraceReader() {
+    close();
+}
+
+void BinTraceReader::open(const std::string & traceFile) {
+    this->traceFile = traceFile;
+    siCache.clear();
+    int fd = ::open(traceFile.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("Runtime error: failed to open trace file.\n");
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < bt::headerSize) {
+        ::close(fd);
+        throw std::runtime_error("Runtime error: truncated binary trace.\n");
+    }
+
+    void * p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        throw std::runtime_error("Runtime error: failed to map binary trace.\n");
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+    base = static_cast<const uint8_t *>(p);
+    size = st.st_size;
+    cur = base;
+
+    if (std::memcmp(cur, bt::magic, sizeof(bt::magic)) != 0) {
+        close();
+        throw std::runtime_error("Runtime error: not a binary trace.\n");
+    }
+    cur += sizeof(bt::magic);
+    if (readU32() != bt::version) {
+        close();
+        throw std::runtime_error("Runtime error: unsupported binary trace version.\n");
+    }
+    readU32(); // reserved
+
+    kernelOff = TraceMark::noKernel;
+    recs.clear();
+    nDef = 0;
+    scanOff = bt::headerSize;
+    done = false;
+}
+
+void BinTraceReader::close() noexcept {
+    if (base)
+        munmap(const_cast<uint8_t *>(base), size);
+    base = nullptr;
+    cur = nullptr;
+    size = 0;
+    done = true;
+}
+
+bool BinTraceReader::eof() const {
+    return done;
+}
+
+void BinTraceReader::reset(const std::string & s) {
+    close();
+    open(s);
+}
+
+const KernelInfo & BinTraceReader::info() const noexcept {
+    return kernelInfo;
+}
+
+uint8_t BinTraceReader::readU8() {
+    if (cur >= base + size)
+        throw std::runtime_error("Runtime error: truncated binary trace.\n");
+    return *cur++;
+}
+
+uint32_t BinTraceReader::readU32() {
+    if (cur + 4 > base + size)
+        throw std::runtime_error("Runtime error: truncated binary trace.\n");
+    uint32_t v = static_cast<uint32_t>(cur[0]) | static_cast<uint32_t>(cur[1]) << 8
+               | static_cast<uint32_t>(cur[2]) << 16 | static_cast<uint32_t>(cur[3]) << 24;
+    cur += 4;
+    return v;
+}
+
+uint64_t BinTraceReader::readVarint() {
+    uint64_t v = 0;
+    for (auto shift = 0; shift < 64; shift += 7) {
+        uint8_t b = readU8();
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return v;
+    }
+    throw std::runtime_error("Runtime error: malformed binary trace.\n");
+}
+
+int64_t BinTraceReader::readZigzag() {
+    uint64_t v = readVarint();
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+// Kernel record after its tag
+void BinTraceReader::enterKernel() {
+    auto len = readVarint();
+    if (cur + len > base + size)
+        throw std::runtime_error("Runtime error: truncated binary trace.\n");
+    kernelInfo.kernelSym.assign(reinterpret_cast<const char *>(cur), len);
+    cur += len;
+
+    siCache.clear();
+    reuseTab = nullptr;
+    if (asmParser) {
+        reuseTab = asmParser->find(kernelInfo.kernelSym);
+        if (!reuseTab)
+            throw std::runtime_error("Runtime error: kernel name error.\n");
+    }
+}
+
+// Def record after its tag; records already collected by scanDefs are skipped
+void BinTraceReader::readDef() {
+    Rec rec;
+    auto recBeg = cur;
+    auto opcode = readVarint();
+    if (opcode >= op::SASS_NUM_opS)
+        throw std::runtime_error("Runtime error: malformed binary trace.\n");
+    rec.opcode = static_cast<op::Opcode>(opcode);
+    auto n = readVarint();
+    rec.regPool.reserve(n);
+    for (uint64_t i = 0; i < n; i++) {
+        auto type = static_cast<reg::OprdT>(readU8());
+        auto index = static_cast<uint32_t>(readVarint());
+        auto pos = static_cast<uint32_t>(readVarint());
+        auto set = static_cast<uint32_t>(readVarint());
+        rec.regPool.push_back(reg::Oprd(type, index, pos, set));
+    }
+    if (nDef++ < recs.size())
+        return;
+    rec.key.assign(1, '\xff'); // keeps binary keys apart from text-trace keys
+    rec.key.append(reinterpret_cast<const char *>(recBeg), cur - recBeg);
+    recs.push_back(std::move(rec));
+    scanOff = cur - base;
+}
+
+// Collects the records defined before file offset off, skipping over everything else
+void BinTraceReader::scanDefs(uint64_t off) {
+    auto resume = cur;
+    auto resumeDef = nDef;
+    cur = base + scanOff;
+    nDef = recs.size();
+    while (cur < base + off) {
+        switch (readU8()) {
+            case bt::RecT::kernel: {
+                auto len = readVarint();
+                if (cur + len > base + size)
+                    throw std::runtime_error("Runtime error: truncated binary trace.\n");
+                cur += len;
+                break;
+            }
+            case bt::RecT::cta:
+                readZigzag();
+                readZigzag();
+                readZigzag();
+                break;
+            case bt::RecT::warp:
+                readVarint();
+                break;
+            case bt::RecT::def:
+                readDef();
+                break;
+            case bt::RecT::inst:
+                readZigzag();
+                readU32();
+                readVarint();
+                break;
+            case bt::RecT::end:
+                cur = base + off;
+                break;
+            default:
+                throw std::runtime_error("Runtime error: trace mark does not match the file.\n");
+        }
+    }
+    scanOff = off;
+    cur = resume;
+    nDef = resumeDef;
+}
+
+sass::Instr BinTraceReader::parse() {
+    while (!done) {
+        if (cur >= base + size) {
+            done = true;
+            break;
+        }
+
+        switch (readU8()) {
+            case bt::RecT::end:
+                done = true;
+                break;
+
+            case bt::RecT::kernel:
+                kernelOff = cur - 1 - base;
+                enterKernel();
+                break;
+
+            case bt::RecT::cta:
+                blockId.x = static_cast<int>(readZigzag());
+                blockId.y = static_cast<int>(readZigzag());
+                blockId.z = static_cast<int>(readZigzag());
+                break;
+
+            case bt::RecT::warp:
+                wId = static_cast<uint32_t>(readVarint());
+                pc = 0;
+                break;
+
+            case bt::RecT::def:
+                readDef();
+                break;
+
+            case bt::RecT::inst: {
+                pc = static_cast<uint32_t>(static_cast<int64_t>(pc) + readZigzag());
+                std::bitset<32> mask(readU32());
+                auto id = readVarint();
+                if (id >= recs.size())
+                    throw std::runtime_error("Runtime error: malformed binary trace.\n");
+
+                auto & si = siCache[(id << 32) | pc];
+                if (!si) {
+                    const auto & rec = recs[id];
+                    si = sTab->intern(kernelInfo.kernelSym, pc, rec.key, [&] {
+                        std::bitset<4> flags;
+                        if (reuseTab)
+                            flags = reuseTab->get(pc);
+                        return sass::StaticInstr{pc, rec.opcode, rec.regPool, flags};
+                    });
+                }
+                return sass::Instr(si, mask, blockId, wId);
+            }
+
+            default:
+                throw std::runtime_error("Runtime error: malformed binary trace.\n");
+        }
+    }
+    return sass::Instr();
+}
+
+TraceMark BinTraceReader::mark() const {
+    TraceMark m;
+    m.off = cur - base;
+    m.kernelOff = kernelOff;
+    m.nDef = nDef;
+    m.blockId = blockId;
+    m.wId = wId;
+    m.pc = pc;
+    return m;
+}
+
+// The kernel record is read again and the def table completed up to the mark
+void BinTraceReader::seek(const TraceMark & m) {
+    if (m.kernelOff == TraceMark::noKernel)
+        reset(traceFile);
+    if (m.off < bt::headerSize || m.off > size)
+        throw std::runtime_error("Runtime error: trace mark does not match the file.\n");
+    if (recs.size() < m.nDef)
+        scanDefs(m.off);
+    if (recs.size() < m.nDef)
+        throw std::runtime_error("Runtime error: trace mark does not match the file.\n");
+
+    if (m.kernelOff != TraceMark::noKernel) {
+        if (m.kernelOff < bt::headerSize || m.kernelOff >= m.off)
+            throw std::runtime_error("Runtime error: trace mark does not match the file.\n");
+        cur = base + m.kernelOff;
+        if (readU8() != bt::RecT::kernel)
+            throw std::runtime_error("Runtime error: trace mark does not match the file.\n");
+        kernelOff = m.kernelOff;
+        enterKernel();
+    }
+
+    cur = base + m.off;
+    nDef = m.nDef;
+    blockId = m.blockId;
+    wId = m.wId;
+    pc = m.pc;
+    done = false;
+}
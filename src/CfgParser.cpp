@@ -14,6 +14,8 @@ namespace cfg {
 		}
     } 
 
+    CfgParser::CfgParser(const YAML::Node & node, const std::shared_ptr<GlobalCfg> & cfg) : yamlNode(node), cfg(cfg) {}
+
     void CfgParser::parse() {
         try {
             cfg->arch = static_cast<SmArch>(yamlNode["arch"].as<int>());
@@ -0,0 +1,356 @@
+#include "Checkpoint.h"
+
+#include <fstream>
+#include <filesystem>
+#include <array>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+#include "TraceReader.h"
+
+namespace Checkpoint {
+
+	namespace {
+
+		template <typename T>
+		void put(std::string & buf, T v) {
+			buf.append(reinterpret_cast<const char *>(&v), sizeof(v));
+		}
+
+		template <typename T>
+		void putVec(std::string & buf, const std::vector<T> & v) {
+			buf.append(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(T));
+		}
+
+		struct Reader {
+			std::ifstream ifs;
+
+			explicit Reader(const std::string & path) : ifs(path, std::ios::binary) {
+				if (!ifs.is_open())
+					throw std::runtime_error("Runtime error: failed to open checkpoint file.\n");
+			}
+
+			void read(void * p, size_t n) {
+				if (!ifs.read(static_cast<char *>(p), n))
+					throw std::runtime_error("Runtime error: truncated checkpoint file.\n");
+			}
+
+			template <typename T>
+			T get() {
+				T v;
+				read(&v, sizeof(v));
+				return v;
+			}
+
+			template <typename T>
+			void getVec(std::vector<T> & v) {
+				read(v.data(), v.size() * sizeof(T));
+			}
+		};
+
+		// Config fields the simulation depends on, in file order
+		using CfgKey = std::array<uint32_t, 9>;
+
+		CfgKey cfgKey(const cfg::GlobalCfg & c) {
+			return {
+				static_cast<uint32_t>(c.alloc), static_cast<uint32_t>(c.repl), static_cast<uint32_t>(c.ev),
+				static_cast<uint32_t>(c.dMap), c.assoc, c.nBlk, c.nDW, c.bw, c.wl
+			};
+		}
+
+		// Fields a forked state must share: the CAM layout and the window length
+		bool sameGeometry(const CfgKey & a, const CfgKey & b) {
+			return a[3] == b[3] && a[4] == b[4] && a[5] == b[5] && a[6] == b[6] && a[8] == b[8];
+		}
+
+		void putStat(std::string & buf, const stat::Stat & s) {
+			for (auto v : {s.mrfRdNum, s.mrfWrNum, s.rfcRdNum, s.rfcWrNum,
+					s.rfcRdHitNum, s.rfcRdMissNum, s.rfcWrHitNum, s.rfcWrMissNum})
+				put<uint64_t>(buf, v);
+		}
+
+		void getStat(Reader & r, std::array<uint64_t, 8> & v) {
+			for (auto & c : v)
+				c = r.get<uint64_t>();
+		}
+
+		void putInst(std::string & buf, const sass::Instr & inst) {
+			put<uint8_t>(buf, inst.si != nullptr);
+			if (!inst.si)
+				return;
+			put<uint32_t>(buf, inst.si->pc);
+			put<uint32_t>(buf, inst.si->opcode);
+			put<uint32_t>(buf, inst.si->regPool.size());
+			for (const auto & oprd : inst.si->regPool) {
+				put<uint32_t>(buf, oprd.type);
+				put<uint32_t>(buf, oprd.index);
+				put<uint32_t>(buf, oprd.pos);
+				put<uint32_t>(buf, oprd.set);
+			}
+			put<uint32_t>(buf, inst.si->reuseFlag.to_ulong());
+			put<uint32_t>(buf, inst.mask.to_ulong());
+			put<int32_t>(buf, inst.tbId.x);
+			put<int32_t>(buf, inst.tbId.y);
+			put<int32_t>(buf, inst.tbId.z);
+			put<uint32_t>(buf, inst.wId);
+		}
+
+		// Window instruction with its own copy of the static part
+		struct WinInst {
+			bool valid;
+			sass::StaticInstr si;
+			std::bitset<32> mask;
+			util::Dim3<int> tbId;
+			uint32_t wId;
+		};
+
+		WinInst getInst(Reader & r) {
+			WinInst w{};
+			w.valid = r.get<uint8_t>();
+			if (!w.valid)
+				return w;
+			w.si.pc = r.get<uint32_t>();
+			w.si.opcode = static_cast<op::Opcode>(r.get<uint32_t>());
+			w.si.regPool.resize(r.get<uint32_t>());
+			for (auto & oprd : w.si.regPool) {
+				oprd.type = static_cast<reg::OprdT>(r.get<uint32_t>());
+				oprd.index = r.get<uint32_t>();
+				oprd.pos = r.get<uint32_t>();
+				oprd.set = r.get<uint32_t>();
+			}
+			w.si.reuseFlag = r.get<uint32_t>();
+			w.mask = r.get<uint32_t>();
+			w.tbId.x = r.get<int32_t>();
+			w.tbId.y = r.get<int32_t>();
+			w.tbId.z = r.get<int32_t>();
+			w.wId = r.get<uint32_t>();
+			return w;
+		}
+
+		struct SlotState {
+			Cam cam;
+			uint32_t leaders;
+			std::array<uint32_t, 32> cls;
+			std::vector<WinInst> win;
+		};
+
+		struct SimState {
+			CfgKey key;
+			bool kernelEnd;
+			std::array<uint64_t, 8> base, rfc;
+			std::vector<SlotState> slots;
+		};
+
+		SimState getSim(Reader & r) {
+			SimState s;
+			for (auto & v : s.key)
+				v = r.get<uint32_t>();
+			s.kernelEnd = r.get<uint8_t>();
+			getStat(r, s.base);
+			getStat(r, s.rfc);
+
+			s.slots.reserve(32);
+			for (auto i = 0; i < 32; i++) {
+				s.slots.push_back(SlotState{Cam(s.key[4], s.key[5], s.key[6]), 0, {}, {}});
+				auto & slot = s.slots.back();
+				slot.cam.clock = r.get<uint32_t>();
+				r.getVec(slot.cam.tag);
+				r.getVec(slot.cam.ts);
+				r.getVec(slot.cam.dt);
+				r.getVec(slot.cam.memTag);
+				slot.leaders = r.get<uint32_t>();
+				for (auto & c : slot.cls)
+					c = r.get<uint32_t>();
+				slot.win.resize(r.get<uint64_t>());
+				for (auto & w : slot.win)
+					w = getInst(r);
+			}
+			return s;
+		}
+
+		void setStat(stat::Stat & s, const std::array<uint64_t, 8> & v) {
+			s.mrfRdNum = v[0];
+			s.mrfWrNum = v[1];
+			s.rfcRdNum = v[2];
+			s.rfcWrNum = v[3];
+			s.rfcRdHitNum = v[4];
+			s.rfcRdMissNum = v[5];
+			s.rfcWrHitNum = v[6];
+			s.rfcWrMissNum = v[7];
+		}
+
+		void restore(const SimState & s, Sim & sim, bool fork) {
+			auto key = cfgKey(*sim.cfg);
+			if (fork ? !sameGeometry(s.key, key) : s.key != key)
+				throw std::invalid_argument(fork
+					? "Invalid input: the checkpoint has another geometry or window length than the config.\n"
+					: "Invalid input: the checkpoint was taken with other configs.\n");
+
+			sim.kernelEnd = s.kernelEnd;
+			if (fork) { // the prefix only warmed the state up
+				sim.scbBase->clear();
+				sim.scb->clear();
+			} else {
+				setStat(*sim.scbBase, s.base);
+				setStat(*sim.scb, s.rfc);
+			}
+
+			// Windows refer to the restored static instructions
+			for (auto & rfc : sim.rfcArry)
+				rfc.iQueue.clear();
+			sim.restored.clear();
+			for (size_t i = 0; i < 32; i++) {
+				auto & rfc = sim.rfcArry[i];
+				const auto & slot = s.slots[i];
+				*rfc.cam = slot.cam;
+				rfc.cam->log.reserve(rfc.cam->nBlk * 32);
+				rfc.leaders = slot.leaders;
+				rfc.cls = slot.cls;
+				rfc.regNext.clear();
+				rfc.flushSimdBuf();
+				for (const auto & w : slot.win) {
+					if (!w.valid) {
+						rfc.iQueue.push(sass::Instr());
+						continue;
+					}
+					sim.restored.push_back(w.si);
+					rfc.iQueue.push(sass::Instr(&sim.restored.back(), w.mask, w.tbId, w.wId));
+				}
+			}
+		}
+
+	};
+
+	void save(const std::string & path, const Pos & pos, size_t nKernel, const std::vector<std::unique_ptr<Sim>> & sims) {
+		std::string buf;
+		buf.append(magic, sizeof(magic));
+		put<uint32_t>(buf, version);
+		put<uint32_t>(buf, sims.size());
+		put<uint64_t>(buf, nKernel);
+		put<uint64_t>(buf, pos.kernel);
+		put<uint64_t>(buf, pos.inst);
+		put<uint64_t>(buf, pos.nInst);
+
+		for (const auto & sim : sims) {
+			for (auto v : cfgKey(*sim->cfg))
+				put<uint32_t>(buf, v);
+			put<uint8_t>(buf, sim->kernelEnd);
+			putStat(buf, *sim->scbBase);
+			putStat(buf, *sim->scb);
+
+			// Between instructions: every tag is synced (empty log)
+			for (const auto & rfc : sim->rfcArry) {
+				put<uint32_t>(buf, rfc.cam->clock);
+				putVec(buf, rfc.cam->tag);
+				putVec(buf, rfc.cam->ts);
+				putVec(buf, rfc.cam->dt);
+				putVec(buf, rfc.cam->memTag);
+				put<uint32_t>(buf, rfc.leaders);
+				for (auto c : rfc.cls)
+					put<uint32_t>(buf, c);
+				put<uint64_t>(buf, rfc.iQueue.size());
+				for (size_t i = 0; i < rfc.iQueue.size(); i++)
+					putInst(buf, rfc.iQueue.at(i));
+			}
+		}
+
+		const std::string tmp = path + ".tmp";
+		std::ofstream of(tmp, std::ios::binary | std::ios::trunc);
+		if (!of.is_open())
+			throw std::runtime_error("Runtime error: failed to create checkpoint file.\n");
+		of.write(buf.data(), buf.size());
+		of.close();
+		if (of.fail())
+			throw std::runtime_error("Runtime error: failed to write checkpoint file.\n");
+
+		std::error_code ec;
+		std::filesystem::rename(tmp, path, ec);
+		if (ec) {
+			std::filesystem::remove(tmp, ec);
+			throw std::runtime_error("Runtime error: failed to write checkpoint file.\n");
+		}
+	}
+
+	Pos load(const std::string & path, size_t nKernel, std::vector<std::unique_ptr<Sim>> & sims, bool fork) {
+		Reader r(path);
+		char head[sizeof(magic)];
+		r.read(head, sizeof(head));
+		if (std::memcmp(head, magic, sizeof(magic)) != 0)
+			throw std::runtime_error("Runtime error: not a checkpoint file.\n");
+		if (r.get<uint32_t>() != version)
+			throw std::runtime_error("Runtime error: unsupported checkpoint version.\n");
+
+		const uint32_t nSim = r.get<uint32_t>();
+		Pos pos;
+		const uint64_t n = r.get<uint64_t>();
+		pos.kernel = r.get<uint64_t>();
+		pos.inst = r.get<uint64_t>();
+		pos.nInst = r.get<uint64_t>();
+		if (n != nKernel || pos.kernel > nKernel)
+			throw std::runtime_error("Runtime error: checkpoint does not match the trace.\n");
+
+		if (nSim == sims.size()) {
+			for (auto & sim : sims)
+				restore(getSim(r), *sim, fork);
+		} else if (fork && nSim == 1) {
+			auto s = getSim(r);
+			for (auto & sim : sims)
+				restore(s, *sim, fork);
+		} else {
+			throw std::invalid_argument("Invalid input: the checkpoint holds " + std::to_string(nSim) + " configs.\n");
+		}
+		return pos;
+	}
+
+	bool run(
+		const std::vector<std::string> & traceList,
+		const std::shared_ptr<AsmParser> & asmParser,
+		std::vector<std::unique_ptr<Sim>> & sims,
+		const Plan & plan
+	) {
+		for (auto & sim : sims) {
+			if (sim->cfg->repl == cfg::ReplPlcy::opt)
+				throw std::invalid_argument("Invalid input: checkpoints do not support OPT replacement.\n");
+		}
+
+		Pos pos;
+		if (!plan.from.empty())
+			pos = load(plan.from, traceList.size(), sims, plan.fork);
+		auto checkpoint = [&] {
+			if (!plan.path.empty())
+				save(plan.path, pos, traceList.size(), sims);
+		};
+
+		for (; pos.kernel < traceList.size(); pos.kernel++, pos.inst = 0) {
+			auto traceParser = TraceReaderFactory::getInstance(traceList[pos.kernel], asmParser);
+			uint64_t skip = pos.inst; // simulated before the checkpoint; parsed again, as traces are not indexed
+			while (!traceParser->eof()) {
+				auto inst = traceParser->parse();
+				if (inst.opcode() == op::OP_VOID && traceParser->eof())
+					break;
+				if (skip) {
+					skip--;
+					continue;
+				}
+				for (auto & sim : sims)
+					sim->exec(inst);
+				pos.inst++;
+				pos.nInst++;
+				if (pos.nInst == plan.prefix) {
+					checkpoint();
+					return false;
+				}
+				if (plan.every && pos.nInst % plan.every == 0)
+					checkpoint();
+			}
+			if (skip)
+				throw std::runtime_error("Runtime error: checkpoint does not match the trace.\n");
+			for (auto & sim : sims)
+				sim->endKernel();
+		}
+		checkpoint();
+		return true;
+	}
+
+};
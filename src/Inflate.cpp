@@ -0,0 +1,222 @@
+#include "Inflate.h"
+
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#ifdef RFCSIM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef RFCSIM_HAVE_LZMA
+#include <lzma.h>
+#endif
+
+InflateStream::Fmt InflateStream::detect(const std::string & file) {
+    static const unsigned char gzMagic[2] = {0x1f, 0x8b};
+    static const unsigned char xzMagic[6] = {0xfd, '7', 'z', 'X', 'Z', 0x00};
+
+    std::ifstream ifs(file, std::ios::binary);
+    unsigned char head[6] = {0};
+    ifs.read(reinterpret_cast<char *>(head), sizeof(head));
+    auto n = ifs.gcount();
+
+    if (n >= 2 && std::memcmp(head, gzMagic, sizeof(gzMagic)) == 0)
+        return Fmt::gzip;
+    if (n >= 6 && std::memcmp(head, xzMagic, sizeof(xzMagic)) == 0)
+        return Fmt::xz;
+    return Fmt::none;
+}
+
+InflateStream::InflateStream(const std::string & file, Fmt fmt)
+    : file(file), fmt(fmt), done(false), stop(false), curPos(0) {
+#ifndef RFCSIM_HAVE_ZLIB
+    if (fmt == Fmt::gzip)
+        throw std::runtime_error("Runtime error: built without gzip support.\n");
+#endif
+#ifndef RFCSIM_HAVE_LZMA
+    if (fmt == Fmt::xz)
+        throw std::runtime_error("Runtime error: built without xz support.\n");
+#endif
+    if (fmt == Fmt::none)
+        throw std::invalid_argument("Invalid input: trace file is not compressed.\n");
+
+    worker = std::thread(&InflateStream::run, this);
+}
+
+InflateStream::~InflateStream() {
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        stop = true;
+    }
+    cvFull.notify_all();
+    if (worker.joinable())
+        worker.join();
+}
+
+// Producer side: blocks while the queue is full, false once the reader is gone
+bool InflateStream::push(std::vector<char> && blk) {
+    std::unique_lock<std::mutex> lk(mtx);
+    cvFull.wait(lk, [this] { return stop || blks.size() < maxBlks; });
+    if (stop)
+        return false;
+    blks.push_back(std::move(blk));
+    lk.unlock();
+    cvEmpty.notify_one();
+    return true;
+}
+
+void InflateStream::run() {
+    try {
+        if (fmt == Fmt::gzip)
+            runGzip();
+        else if (fmt == Fmt::xz)
+            runXz();
+    } catch (...) {
+        std::lock_guard<std::mutex> lk(mtx);
+        err = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        done = true;
+    }
+    cvEmpty.notify_one();
+}
+
+void InflateStream::runGzip() {
+#ifdef RFCSIM_HAVE_ZLIB
+    std::ifstream ifs(file, std::ios::binary);
+    if (!ifs.is_open())
+        throw std::runtime_error("Runtime error: failed to open trace file.\n");
+
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 32) != Z_OK) // gzip or zlib header
+        throw std::runtime_error("Runtime error: failed to initialize gzip decoder.\n");
+
+    std::vector<char> in(1 << 20);
+    std::vector<char> out(blkSize);
+    zs.next_out = reinterpret_cast<Bytef *>(out.data());
+    zs.avail_out = out.size();
+
+    bool inEof = false;
+    int ret = Z_OK;
+    while (true) {
+        if (zs.avail_in == 0 && !inEof) {
+            ifs.read(in.data(), in.size());
+            zs.next_in = reinterpret_cast<Bytef *>(in.data());
+            zs.avail_in = ifs.gcount();
+            inEof = zs.avail_in == 0;
+        }
+
+        ret = inflate(&zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            // Concatenated gzip members
+            if (zs.avail_in > 0 || (!inEof && ifs.peek() != std::char_traits<char>::eof()))
+                inflateReset(&zs);
+            else
+                inEof = true;
+        }
+        else if (ret == Z_BUF_ERROR && inEof) {
+            inflateEnd(&zs);
+            throw std::runtime_error("Runtime error: truncated gzip trace.\n");
+        }
+        else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            inflateEnd(&zs);
+            throw std::runtime_error("Runtime error: corrupted gzip trace.\n");
+        }
+
+        bool finished = inEof && (ret == Z_STREAM_END);
+        if (zs.avail_out == 0 || finished) {
+            out.resize(out.size() - zs.avail_out);
+            if (!out.empty() && !push(std::move(out)))
+                break;
+            out = std::vector<char>(blkSize);
+            zs.next_out = reinterpret_cast<Bytef *>(out.data());
+            zs.avail_out = out.size();
+        }
+        if (finished)
+            break;
+    }
+    inflateEnd(&zs);
+#endif
+}
+
+void InflateStream::runXz() {
+#ifdef RFCSIM_HAVE_LZMA
+    std::ifstream ifs(file, std::ios::binary);
+    if (!ifs.is_open())
+        throw std::runtime_error("Runtime error: failed to open trace file.\n");
+
+    lzma_stream ls = LZMA_STREAM_INIT;
+    if (lzma_stream_decoder(&ls, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+        throw std::runtime_error("Runtime error: failed to initialize xz decoder.\n");
+
+    std::vector<char> in(1 << 20);
+    std::vector<char> out(blkSize);
+    ls.next_out = reinterpret_cast<uint8_t *>(out.data());
+    ls.avail_out = out.size();
+
+    lzma_action action = LZMA_RUN;
+    while (true) {
+        if (ls.avail_in == 0 && action == LZMA_RUN) {
+            ifs.read(in.data(), in.size());
+            ls.next_in = reinterpret_cast<const uint8_t *>(in.data());
+            ls.avail_in = ifs.gcount();
+            if (ls.avail_in == 0)
+                action = LZMA_FINISH;
+        }
+
+        lzma_ret ret = lzma_code(&ls, action);
+        if (ret != LZMA_OK && ret != LZMA_STREAM_END) {
+            lzma_end(&ls);
+            throw std::runtime_error("Runtime error: corrupted xz trace.\n");
+        }
+
+        bool finished = ret == LZMA_STREAM_END;
+        if (ls.avail_out == 0 || finished) {
+            out.resize(out.size() - ls.avail_out);
+            if (!out.empty() && !push(std::move(out)))
+                break;
+            out = std::vector<char>(blkSize);
+            ls.next_out = reinterpret_cast<uint8_t *>(out.data());
+            ls.avail_out = out.size();
+        }
+        if (finished)
+            break;
+    }
+    lzma_end(&ls);
+#endif
+}
+
+size_t InflateStream::read(char * dst, size_t n) {
+    size_t acc = 0;
+    while (acc < n) {
+        if (curPos == cur.size()) {
+            std::unique_lock<std::mutex> lk(mtx);
+            cvEmpty.wait(lk, [this] { return done || !blks.empty(); });
+            if (blks.empty()) {
+                if (err)
+                    std::rethrow_exception(err);
+                break; // end of stream
+            }
+            cur = std::move(blks.front());
+            blks.pop_front();
+            curPos = 0;
+            lk.unlock();
+            cvFull.notify_one();
+        }
+
+        size_t len = std::min(n - acc, cur.size() - curPos);
+        std::memcpy(dst + acc, cur.data() + curPos, len);
+        curPos += len;
+        acc += len;
+
+        // Hand out whole blocks as soon as possible, the caller refills anyway
+        if (acc > 0 && curPos == cur.size())
+            break;
+    }
+    return acc;
+}
@@ -0,0 +1,234 @@
+#include "LaneSetSim.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "ThreadPool.h"
+
+namespace {
+
+	uint32_t reverseBits(uint32_t v) noexcept {
+		v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+		v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+		v = ((v >> 4) & 0x0f0f0f0fu) | ((v & 0x0f0f0f0fu) << 4);
+		v = ((v >> 8) & 0x00ff00ffu) | ((v & 0x00ff00ffu) << 8);
+		return (v >> 16) | (v << 16);
+	}
+
+	constexpr uint32_t emptyTag = 256; // CacheEntry::clear()
+
+};
+
+LaneSetSim::LaneSetSim(Sim & sim) : sim(sim), nPending(0) {
+	const auto & cfg = *sim.cfg;
+	assoc = cfg.assoc;
+	nSet = cfg.nBlk / cfg.assoc;
+	nLane = cfg.bw / 32;
+
+	// Groups of whole banks; Rfc::bankTxCnt only tiles the warp exactly when a bank width divides it
+	groupSize = nLane > 0 && 32 % nLane == 0 ? std::max<uint32_t>(nLane, 8) : 32;
+
+	t.assign(32, 0);
+	accs.resize(32 * nSet);
+	shards.assign(32 * nSet * (32 / groupSize), stat::Stat(cfg.eMdl));
+
+	// Ages of the current CAM state, taken as of instruction 0
+	entries.resize(32 * nSet * 32 * assoc);
+	for (uint32_t slot = 0; slot < 32; slot++) {
+		sim.rfcArry[slot].unfold();
+		const auto & cam = *sim.rfcArry[slot].cam;
+		for (uint32_t set = 0; set < nSet; set++) {
+			for (uint32_t lane = 0; lane < 32; lane++) {
+				for (uint32_t way = 0; way < assoc; way++) {
+					const auto e = cam.entry(lane, set * assoc + way);
+					entries[((slot * nSet + set) * 32 + lane) * assoc + way] = Entry{e.tag, e.dt, 1 - int64_t(e.age)};
+				}
+			}
+		}
+	}
+}
+
+void LaneSetSim::exec(const sass::Instr & inst) {
+	if (sim.kernelEnd)
+		return;
+
+	uint32_t slot = inst.wId % 32;
+	auto & rfc = sim.rfcArry.at(slot);
+	sass::Instr instFront;
+	auto s = rfc.slide(inst, instFront);
+	if (s != Slide::exec) {
+		sim.kernelEnd = s == Slide::end;
+		return;
+	}
+
+	t[slot]++;
+	rfc.flags = instFront.reuseFlag();
+	uint32_t lanes = reverseBits(static_cast<uint32_t>(instFront.mask.to_ulong()));
+	uint32_t nAct = __builtin_popcount(lanes);
+
+	for (const auto & oprd : instFront.regPool()) {
+		if (oprd.type == reg::OprdT::addr)
+			continue;
+		bool dst = oprd.type != reg::OprdT::src;
+		sim.scbBase->trigger(dst ? stat::Event::mrfWr : stat::Event::mrfRd, nAct);
+		auto set = rfc.getCacheSet(oprd);
+		if (set >= nSet)
+			throw std::out_of_range("Runtime error: cache set out of range.\n");
+		accs[slot * nSet + set].push_back(
+			Access{t[slot], oprd.index / sim.cfg->nDW, lanes, dst, rfc.allocator->fill(oprd)}
+		);
+		nPending++;
+	}
+}
+
+void LaneSetSim::endKernel() {
+	const sass::Instr voidInst = sass::Instr();
+	while (!sim.kernelEnd)
+		exec(voidInst);
+	sim.kernelEnd = false;
+}
+
+size_t LaneSetSim::pending() const noexcept {
+	return nPending;
+}
+
+void LaneSetSim::submit(ThreadPool & pool) {
+	for (uint32_t slot = 0; slot < 32; slot++) {
+		for (uint32_t set = 0; set < nSet; set++) {
+			if (accs[slot * nSet + set].empty())
+				continue;
+			for (uint32_t lo = 0; lo < 32; lo += groupSize)
+				pool.submit([this, slot, set, lo](size_t) { run(slot, set, lo); });
+		}
+	}
+}
+
+void LaneSetSim::clear() noexcept {
+	for (auto & a : accs)
+		a.clear();
+	nPending = 0;
+}
+
+// Rfc::exec for one cache set of threads [lo, lo + groupSize) of a warp slot
+void LaneSetSim::run(uint32_t slot, uint32_t set, uint32_t lo) {
+	const auto & cfg = *sim.cfg;
+	const bool lru = cfg.repl == cfg::ReplPlcy::lru;
+	const bool wt = cfg.ev == cfg::EvictPlcy::writeThrough;
+	const uint32_t hi = lo + groupSize;
+	const uint32_t groupMask = groupSize == 32 ? ~0u : ((1u << groupSize) - 1) << lo;
+
+	const auto & acc = accs[slot * nSet + set];
+	Entry * cam = &entries[(slot * nSet + set) * 32 * assoc];
+	std::vector<Entry> mem(groupSize * assoc); // CAM as of the start of the instruction
+	uint64_t n[8] = {}; // rdHit, rdMiss, wrHit, wrMiss, rfcRd, rfcWr, mrfRd, mrfWr
+
+	// Bank transactions of a group of threads, as Rfc::bankTxCnt
+	auto bankTx = [&](uint32_t bits) {
+		uint32_t cnt = 0;
+		for (uint32_t i = lo; i < hi; i += std::max<uint32_t>(nLane, 1)) {
+			uint32_t w = std::min(nLane, 32 - i);
+			uint32_t m = w == 32 ? ~0u : ((1u << w) - 1) << i;
+			cnt += (bits & m) != 0;
+		}
+		return cnt;
+	};
+
+	for (size_t i = 0; i < acc.size(); i++) {
+		const auto & a = acc[i];
+		uint32_t act = a.lanes & groupMask;
+
+		// Searches see the CAM before the instruction (Rfc::sync), which only differs from the current
+		// state when the instruction accesses this set more than once
+		bool first = i == 0 || acc[i - 1].t != a.t;
+		bool snap = !first || (i + 1 < acc.size() && acc[i + 1].t == a.t);
+		if (first && snap)
+			std::copy(cam + lo * assoc, cam + hi * assoc, mem.begin());
+
+		uint32_t rfcRd = 0, rfcWr = 0;
+		for (auto m = act; m; m &= m - 1) {
+			uint32_t lane = __builtin_ctz(m);
+			Entry * e = cam + lane * assoc;
+			const Entry * s = snap ? &mem[(lane - lo) * assoc] : e;
+
+			uint32_t way = 0;
+			while (way < assoc && s[way].tag != a.tag)
+				way++;
+
+			if (way < assoc) { // Rfc::hitHandler
+				if (!a.dst) {
+					n[0]++;
+					if (lru)
+						e[way].ts = a.t;
+					e[way].dt = false;
+					rfcRd |= 1u << lane;
+				} else {
+					n[2]++;
+					rfcWr |= 1u << lane;
+					e[way].ts = a.t;
+					e[way].dt = !wt;
+					if (wt)
+						n[7]++;
+				}
+				continue;
+			}
+
+			n[a.dst ? 3 : 1]++;
+			if (!a.fill) {
+				n[a.dst ? 7 : 6]++;
+				continue;
+			}
+
+			// Rfc::replWrapper: first empty block, else the oldest (first of the oldest)
+			uint32_t victim = 0;
+			bool dirty = false;
+			for (way = 0; way < assoc && e[way].tag != emptyTag; way++) {
+				if (e[way].ts < e[victim].ts)
+					victim = way;
+			}
+			if (way < assoc)
+				victim = way;
+			else
+				dirty = e[victim].dt;
+
+			e[victim] = Entry{a.tag, a.dst, a.t};
+			rfcWr |= 1u << lane;
+			if (!a.dst)
+				n[6]++;
+			if (dirty)
+				n[7]++;
+		}
+		n[4] += bankTx(rfcRd);
+		n[5] += bankTx(rfcWr);
+	}
+
+	auto & st = shards[(slot * nSet + set) * (32 / groupSize) + lo / groupSize];
+	st.trigger(stat::Event::rdHit, n[0]);
+	st.trigger(stat::Event::rdMiss, n[1]);
+	st.trigger(stat::Event::wrHit, n[2]);
+	st.trigger(stat::Event::wrMiss, n[3]);
+	st.rfcRdNum += n[4];
+	st.rfcWrNum += n[5];
+	st.mrfRdNum += n[6];
+	st.mrfWrNum += n[7];
+}
+
+void LaneSetSim::finish() {
+	for (auto & st : shards) {
+		sim.scb->merge(st);
+		st.clear();
+	}
+
+	for (uint32_t slot = 0; slot < 32; slot++) {
+		auto & cam = *sim.rfcArry[slot].cam;
+		for (uint32_t set = 0; set < nSet; set++) {
+			for (uint32_t lane = 0; lane < 32; lane++) {
+				for (uint32_t way = 0; way < assoc; way++) {
+					const auto & e = entries[((slot * nSet + set) * 32 + lane) * assoc + way];
+					int64_t age = std::min<int64_t>(1 + t[slot] - e.ts, std::numeric_limits<uint32_t>::max());
+					cam.set(lane, set * assoc + way, e.tag, static_cast<uint32_t>(age), e.dt);
+				}
+			}
+		}
+		cam.sync();
+	}
+}
@@ -0,0 +1,65 @@
+#include "NextUse.h"
+
+#include <array>
+#include <stdexcept>
+
+#include "TraceReader.h"
+
+namespace NextUse {
+
+	void annotate(std::vector<sass::Instr> & insts, std::vector<uint32_t> & dist) {
+		constexpr uint32_t maxReg = 1 << 16;
+		constexpr uint32_t unseen = 0;
+
+		std::vector<size_t> offset(insts.size() + 1, 0);
+		for (size_t i = 0; i < insts.size(); i++)
+			offset[i + 1] = offset[i] + insts[i].regPool().size();
+		dist.assign(offset.back(), 0);
+
+		// Positions count instructions of a slot from the end of the kernel (1 = last), so that the
+		// distance to the next access is known without a forward pass
+		std::array<uint32_t, 32> pos;
+		pos.fill(0);
+		std::array<std::vector<uint32_t>, 32> last; // position of the next access of every register
+		for (size_t i = insts.size(); i-- > 0;) {
+			const auto & inst = insts[i];
+			const auto & pool = inst.regPool();
+			uint32_t slot = inst.wId % 32;
+			uint32_t p = ++pos[slot];
+			auto & l = last[slot];
+
+			// Accesses within the instruction itself do not count as the next use
+			for (size_t j = 0; j < pool.size(); j++) {
+				if (pool[j].type == reg::OprdT::addr)
+					continue;
+				if (pool[j].index >= maxReg)
+					throw std::invalid_argument("Invalid input: register index.\n");
+				if (pool[j].index < l.size() && l[pool[j].index] != unseen)
+					dist[offset[i] + j] = p - l[pool[j].index];
+			}
+			for (const auto & oprd : pool) {
+				if (oprd.type == reg::OprdT::addr)
+					continue;
+				if (oprd.index >= l.size())
+					l.resize(oprd.index + 1, unseen);
+				l[oprd.index] = p;
+			}
+		}
+
+		for (size_t i = 0; i < insts.size(); i++)
+			insts[i].nextUse = dist.data() + offset[i];
+	}
+
+	void load(const std::string & traceFile, const std::shared_ptr<AsmParser> & asmParser, Kernel & kernel) {
+		kernel.insts.clear();
+		auto traceParser = TraceReaderFactory::getInstance(traceFile, asmParser);
+		while (!traceParser->eof()) {
+			auto inst = traceParser->parse();
+			if (inst.opcode() == op::OP_VOID && traceParser->eof())
+				break;
+			kernel.insts.push_back(inst);
+		}
+		annotate(kernel.insts, kernel.dist);
+	}
+
+};
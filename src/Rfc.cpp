@@ -1,5 +1,9 @@
 #include "Rfc.h"
 
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 CacheEntry::CacheEntry() {
     tag = 256;
     age = 0;
@@ -28,11 +32,20 @@ void CacheEntry::set(uint32_t tag, uint32_t age, bool dt) noexcept {
 }
 
 // struct Cam
+Cam::Cam(uint32_t assoc, uint32_t nBlk, uint32_t nDW) : assoc(assoc), nBlk(nBlk), nDW(nDW), clock(0) {
+    const CacheEntry e;
+    tag.assign(nBlk * 32, e.tag);
+    ts.assign(nBlk * 32, 1 + clock - e.age);
+    dt.assign(nBlk * 32, e.dt);
+    memTag.assign(nBlk * 32, e.tag);
+    log.reserve(nBlk * 32);
+}
+
 std::ostream & operator<<(std::ostream & os, const Cam & cam) {
     os << "[FSM]:\n\t";
-    for (auto & blk : cam.mem) {
-        for (auto & e : blk) {
-            os << e << " ";
+    for (uint32_t tid = 0; tid < 32; tid++) {
+        for (uint32_t i = 0; i < cam.nBlk; i++) {
+            os << cam.entry(tid, i) << " ";
         }
         os << "\n\t";
     }
@@ -40,36 +53,130 @@ std::ostream & operator<<(std::ostream & os, const Cam & cam) {
 }
 
 void Cam::flush() {
-    
-    for (auto & blk : mem) {
-        for (auto & e : blk) e.clear();
-    }
-    
-    for (auto & blk : vMem) {
-        for (auto & e : blk) e.clear();
-    }
-
+    const CacheEntry e;
+    std::fill(tag.begin(), tag.end(), e.tag);
+    std::fill(ts.begin(), ts.end(), 1 + clock - e.age);
+    std::fill(dt.begin(), dt.end(), e.dt);
+    std::fill(memTag.begin(), memTag.end(), e.tag);
+    log.clear();
 }
 
+// Ages every entry by one
 void Cam::step() {
-    for (auto & blk : vMem) {
-        for (auto & e : blk) e.step();
-    }
+    clock++;
 }
 
-std::pair<bool, uint32_t> Cam::search(uint32_t tid, uint32_t tag, uint32_t setId) {
+namespace {
+
+    // Threads of one entry whose tag equals t
+    inline uint32_t matchLanes(const uint32_t * row, uint32_t t) noexcept {
+#if defined(__AVX512F__)
+        const __m512i key = _mm512_set1_epi32(static_cast<int>(t));
+        uint32_t lo = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(row), key);
+        uint32_t hi = _mm512_cmpeq_epi32_mask(_mm512_loadu_si512(row + 16), key);
+        return lo | (hi << 16);
+#elif defined(__AVX2__)
+        const __m256i key = _mm256_set1_epi32(static_cast<int>(t));
+        uint32_t m = 0;
+        for (int k = 0; k < 4; k++) {
+            __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + 8 * k)), key);
+            m |= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(eq))) << (8 * k);
+        }
+        return m;
+#else
+        uint32_t m = 0;
+        for (uint32_t tid = 0; tid < 32; tid++)
+            m |= static_cast<uint32_t>(row[tid] == t) << tid;
+        return m;
+#endif
+    }
+
+};
+
+uint32_t Cam::search(uint32_t t, uint32_t setId, std::array<uint32_t, 32> & idx) const {
     uint32_t startIdx = setId * assoc;
     uint32_t endIdx = startIdx + assoc;
-    
-    for (auto i = startIdx; i < endIdx; i++) {
-        const auto & e = mem[tid].at(i);
-        if (e.tag == tag)
-            return std::make_pair<bool, uint32_t>(true, std::move(i));
-    }    
-    return std::make_pair<bool, uint32_t>(false, std::move(endIdx));
+    if (endIdx > nBlk)
+        throw std::out_of_range("Runtime error: cache set out of range.\n");
+    uint32_t hit = 0;
+
+    for (auto i = startIdx; i < endIdx && hit != ~0u; i++) {
+        uint32_t m = matchLanes(&memTag[i * 32], t);
+        // First matching entry of each thread
+        for (uint32_t f = m & ~hit; f; f &= f - 1)
+            idx[__builtin_ctz(f)] = i;
+        hit |= m;
+    }
+    return hit;
 }
 
 // ============================================== RFC ===============================
+namespace {
+
+    template <cfg::AllocPlcy> struct AllocOf;
+    template <> struct AllocOf<cfg::AllocPlcy::writeAlloc> { using type = WriteAllocator; };
+    template <> struct AllocOf<cfg::AllocPlcy::cplAidedAlloc> { using type = CplAidedAllocator; };
+    template <> struct AllocOf<cfg::AllocPlcy::lookAheadAlloc> { using type = LookAheadAllocator; };
+
+    bool isPow2(uint32_t v) noexcept {
+        return v && !(v & (v - 1));
+    }
+
+    // Geometry that getCacheSet() and the tag computation can do with shifts and masks
+    bool pow2Geometry(const cfg::GlobalCfg & cfg) noexcept {
+        return isPow2(cfg.nDW) && cfg.assoc && cfg.nBlk % cfg.assoc == 0 && isPow2(cfg.nBlk / cfg.assoc);
+    }
+
+    template <cfg::AllocPlcy A, cfg::ReplPlcy R, cfg::EvictPlcy E, cfg::DestMap D>
+    Rfc::Kernel pickGeometry(const cfg::GlobalCfg & cfg) {
+        return pow2Geometry(cfg) ? &Rfc::run<A, R, E, D, true> : &Rfc::run<A, R, E, D, false>;
+    }
+
+    template <cfg::AllocPlcy A, cfg::ReplPlcy R, cfg::EvictPlcy E>
+    Rfc::Kernel pickDestMap(const cfg::GlobalCfg & cfg) {
+        switch (cfg.dMap) {
+            case cfg::DestMap::ln: return pickGeometry<A, R, E, cfg::DestMap::ln>(cfg);
+            case cfg::DestMap::itl: return pickGeometry<A, R, E, cfg::DestMap::itl>(cfg);
+        }
+        throw std::invalid_argument("Invalid input: unknown destination mapping.\n");
+    }
+
+    template <cfg::AllocPlcy A, cfg::ReplPlcy R>
+    Rfc::Kernel pickEvict(const cfg::GlobalCfg & cfg) {
+        switch (cfg.ev) {
+            case cfg::EvictPlcy::writeBack: return pickDestMap<A, R, cfg::EvictPlcy::writeBack>(cfg);
+            case cfg::EvictPlcy::writeThrough: return pickDestMap<A, R, cfg::EvictPlcy::writeThrough>(cfg);
+        }
+        throw std::invalid_argument("Invalid input: unknown eviction policy.\n");
+    }
+
+    template <cfg::AllocPlcy A>
+    Rfc::Kernel pickRepl(const cfg::GlobalCfg & cfg) {
+        switch (cfg.repl) {
+            case cfg::ReplPlcy::lru: return pickEvict<A, cfg::ReplPlcy::lru>(cfg);
+            case cfg::ReplPlcy::fifo: return pickEvict<A, cfg::ReplPlcy::fifo>(cfg);
+            case cfg::ReplPlcy::opt: return pickEvict<A, cfg::ReplPlcy::opt>(cfg);
+        }
+        throw std::invalid_argument("Invalid input: unknown replacement policy.\n");
+    }
+
+    // One instantiation of Rfc::run per policy combination, chosen once per Rfc
+    Rfc::Kernel pickKernel(const cfg::GlobalCfg & cfg) {
+        switch (cfg.alloc) {
+            case cfg::AllocPlcy::writeAlloc: return pickRepl<cfg::AllocPlcy::writeAlloc>(cfg);
+            case cfg::AllocPlcy::cplAidedAlloc: return pickRepl<cfg::AllocPlcy::cplAidedAlloc>(cfg);
+            case cfg::AllocPlcy::lookAheadAlloc: return pickRepl<cfg::AllocPlcy::lookAheadAlloc>(cfg);
+            default: break;
+        }
+        throw std::runtime_error("null allocator.\n");
+    }
+
+    uint32_t ilog2(uint32_t v) noexcept {
+        return v ? 31 - __builtin_clz(v) : 0;
+    }
+
+};
+
 Rfc::Rfc(
     const std::shared_ptr<cfg::GlobalCfg> & cfg, 
     const std::shared_ptr<stat::Stat> & scbBase, 
@@ -79,6 +186,20 @@ Rfc::Rfc(
     allocator = AllocatorFactory::getInstance(this, *cfg);
     if (!allocator)
         throw std::runtime_error("null allocator.\n");
+
+    bankLead = 0;
+    for (uint32_t i = 0; i < 32; i += std::max<uint32_t>(cfg->bw / 32, 1))
+        bankLead |= 1u << i;
+
+    kernel = pickKernel(*cfg);
+    tick = 0;
+    dwShift = ilog2(cfg->nDW);
+    setShift = cfg->assoc ? ilog2(cfg->nBlk / cfg->assoc) : 0;
+
+    // A cold CAM is the same for every thread
+    leaders = 1;
+    cls.fill(0);
+    cls[0] = ~0u;
 }
 
 Rfc::Rfc(const Rfc& rfcCpy) {
@@ -89,7 +210,17 @@ Rfc::Rfc(const Rfc& rfcCpy) {
     flags = rfcCpy.flags;
     simdBuf = rfcCpy.simdBuf;
     iQueue = rfcCpy.iQueue; 
-    cam = std::make_unique<Cam>(cfg->assoc, cfg->nBlk, cfg->nDW);
+    bankLead = rfcCpy.bankLead;
+    lanes = rfcCpy.lanes;
+    hitIdx = rfcCpy.hitIdx;
+    kernel = rfcCpy.kernel;
+    regNext = rfcCpy.regNext;
+    tick = rfcCpy.tick;
+    dwShift = rfcCpy.dwShift;
+    setShift = rfcCpy.setShift;
+    cam = std::make_unique<Cam>(*rfcCpy.cam);
+    leaders = rfcCpy.leaders;
+    cls = rfcCpy.cls;
     allocator = AllocatorFactory::getInstance(this, *cfg);
     if (!allocator)
         throw std::runtime_error("null allocator.\n");
@@ -105,8 +236,18 @@ void Rfc::step() noexcept {
 
 // Cache bank transaction count
 uint32_t Rfc::bankTxCnt(const std::bitset<32>& buf) {
-    uint32_t acc = 0;
     auto nLane = cfg->bw / 32;
+
+    // Banks that tile the warp: fold every bank onto its first thread
+    if (nLane > 0 && 32 % nLane == 0) {
+        uint32_t bits = static_cast<uint32_t>(buf.to_ulong());
+        uint32_t any = 0;
+        for (uint32_t k = 0; k < nLane; k++)
+            any |= bits >> k;
+        return __builtin_popcount(any & bankLead);
+    }
+
+    uint32_t acc = 0;
     for (auto i = 0; i < 32; i += nLane) {
         for (auto j = i; j < i + nLane; j++) {
             if (buf[j])  {
@@ -118,6 +259,23 @@ uint32_t Rfc::bankTxCnt(const std::bitset<32>& buf) {
     return acc;
 }
 
+// getCacheSet() for a fixed destination mapping; with Pow2 the divisions become shifts
+template <cfg::DestMap D, bool Pow2>
+uint32_t Rfc::cacheSet(const reg::Oprd& oprd) const noexcept {
+    if (oprd.type == reg::OprdT::src)
+        return Pow2 ? oprd.pos & ((1u << setShift) - 1) : oprd.pos % (cfg->nBlk / cfg->assoc);
+
+    if (oprd.type == reg::OprdT::dst) {
+        uint32_t t = Pow2 ? oprd.index >> dwShift : oprd.index / cfg->nDW;
+        if (D == cfg::DestMap::ln)
+            return Pow2 ? (t << setShift) >> 8 : t * cfg->nBlk / (256 * cfg->assoc);
+        else
+            return Pow2 ? t & ((1u << setShift) - 1) : t % (cfg->nBlk / cfg->assoc);
+    }
+
+    return 0;
+}
+
 uint32_t Rfc::getCacheSet(const reg::Oprd& oprd) noexcept {
     
     // Map source operands based on index
@@ -135,134 +293,296 @@ uint32_t Rfc::getCacheSet(const reg::Oprd& oprd) noexcept {
     return 0;
 }
 
-std::pair<bool, uint32_t> Rfc::search(const reg::Oprd & oprd, uint32_t tid, uint32_t setId) {
-    return cam->search(tid, oprd.index / cfg->nDW, setId);
+// Threads hitting on the operand, matching entries in hitIdx
+uint32_t Rfc::search(const reg::Oprd & oprd, uint32_t setId) {
+    return cam->search(oprd.index / cfg->nDW, setId, hitIdx);
 }
 
-// FSM state transition
+// FSM state transition: only tags are read through the snapshot, so only the logged entries are committed
 void Cam::sync() {
-    mem = vMem;
+    for (auto e : log)
+        memTag[e] = tag[e];
+    log.clear();
 }
 
 void Rfc::sync() {
     cam->sync();
 }
 
+// Drops all cached registers and the look-ahead window, e.g., at a kernel boundary
+void Rfc::flush() {
+    cam->flush();
+    iQueue.clear();
+    regNext.clear();
+    flushSimdBuf();
+    leaders = 1;
+    cls.fill(0);
+    cls[0] = ~0u;
+}
+
+// Splits every class that the mask only partly covers; the part without the leader gets its own leader,
+// a copy of the leader's column
+void Rfc::refine(uint32_t act) {
+    for (auto l = leaders; l; l &= l - 1) {
+        uint32_t tid = __builtin_ctz(l);
+        uint32_t in = cls[tid] & act;
+        if (in == 0 || in == cls[tid])
+            continue;
+        uint32_t part = (in >> tid) & 1 ? cls[tid] & ~act : in;
+        uint32_t nl = __builtin_ctz(part);
+        cam->copyColumn(tid, nl);
+        cls[tid] &= ~part;
+        cls[nl] = part;
+        leaders |= 1u << nl;
+    }
+}
+
+// Every thread gets its own up-to-date column and class
+void Rfc::unfold() {
+    for (auto l = leaders; l; l &= l - 1) {
+        uint32_t tid = __builtin_ctz(l);
+        for (auto m = cls[tid] & ~(1u << tid); m; m &= m - 1)
+            cam->copyColumn(tid, __builtin_ctz(m));
+    }
+    leaders = ~0u;
+    for (uint32_t tid = 0; tid < 32; tid++)
+        cls[tid] = 1u << tid;
+}
+
+// Leader mask -> the threads of their classes
+uint32_t Rfc::expand(uint32_t m) const noexcept {
+    uint32_t r = 0;
+    for (; m; m &= m - 1)
+        r |= cls[__builtin_ctz(m)];
+    return r;
+}
+
 void Rfc::flushSimdBuf() {
     for (auto & bs: simdBuf) {
         bs.reset();
     }
 }
 
-bool Rfc::exec(const sass::Instr & inst) {
-    sass::Instr instFront;
-    if (cfg->wl == 0 && inst.opcode != op::OP_VOID) {
+// Pushes inst into the look-ahead window; instFront is the instruction to execute
+Slide Rfc::slide(const sass::Instr & inst, sass::Instr & instFront) {
+    if (cfg->wl == 0 && inst.opcode() != op::OP_VOID) {
 		instFront = inst;
 	}
-	else if (cfg->wl == 0 && inst.opcode == op::OP_VOID) {
-		return true;
+	else if (cfg->wl == 0 && inst.opcode() == op::OP_VOID) {
+		return Slide::end;
 	}
-	else if (iQueue.size() < cfg->wl && inst.opcode != op::OP_VOID) { // warming up
+	else if (iQueue.size() < cfg->wl && inst.opcode() != op::OP_VOID) { // warming up
         iQueue.push(inst);
-        return false;
+        return Slide::warm;
     }
-    else if (iQueue.size() <= cfg->wl && iQueue.size() != 0 && inst.opcode == op::OP_VOID) { // drain
+    else if (iQueue.size() <= cfg->wl && iQueue.size() != 0 && inst.opcode() == op::OP_VOID) { // drain
         instFront = iQueue.front();
         iQueue.pop();
     }
-    else if (iQueue.size() == 0 && inst.opcode == op::OP_VOID) { // drain end
-        return true; // EOF
+    else if (iQueue.size() == 0 && inst.opcode() == op::OP_VOID) { // drain end
+        return Slide::end; // EOF
     } 
     else { // stable
         instFront = iQueue.front();
         iQueue.push(inst);
         iQueue.pop();
     }
+    return Slide::exec;
+}
+
+bool Rfc::exec(const sass::Instr & inst) {
+    sass::Instr instFront;
+    auto s = slide(inst, instFront);
+    if (s != Slide::exec)
+        return s == Slide::end;
 
+    (this->*kernel)(instFront);
+    return false;
+}
+
+template <cfg::AllocPlcy A, cfg::ReplPlcy R, cfg::EvictPlcy E, cfg::DestMap D, bool Pow2>
+void Rfc::run(const sass::Instr & instFront) {
     step();
-    flags = instFront.reuseFlag;
+    if constexpr (R == cfg::ReplPlcy::opt)
+        noteUses(instFront);
+    flags = instFront.reuseFlag();
     mask = instFront.mask;
 
-    // CC Execution Flow 
-    for (const auto & oprd : instFront.regPool) {
+    // thread tid is bit 31 - tid of the mask
+    lanes = 0;
+    for (auto tid = 0; tid < 32; tid++)
+        lanes |= static_cast<uint32_t>(mask[31 - tid]) << tid;
+    const uint32_t nAct = __builtin_popcount(lanes);
+
+    // Only the leaders of the active classes are simulated, their outcomes hold for the whole class
+    refine(lanes);
+    const uint32_t actLeaders = leaders & lanes;
+    auto full = [this](const std::bitset<32> & b) {
+        return std::bitset<32>(expand(static_cast<uint32_t>(b.to_ulong())));
+    };
+
+    // CC Execution Flow: every operand is looked up for all threads at once
+    for (const auto & oprd : instFront.regPool()) {
         auto tp = oprd.type;
         if (tp == reg::OprdT::addr)  continue;
 
-        for (auto tid = 0; tid < 32; tid++) {
-            if (!mask[31 - tid])
-                continue;
+        (oprd.type == reg::OprdT::src) ? scbBase->trigger(stat::Event::mrfRd, nAct) : scbBase->trigger(stat::Event::mrfWr, nAct);
 
-            (oprd.type == reg::OprdT::src) ? scbBase->trigger(stat::Event::mrfRd) : scbBase->trigger(stat::Event::mrfWr);
+        uint32_t setId = cacheSet<D, Pow2>(oprd);
+        uint32_t hit = cam->search(Pow2 ? oprd.index >> dwShift : oprd.index / cfg->nDW, setId, hitIdx) & actLeaders;
+        uint32_t miss = actLeaders & ~hit;
 
-            std::pair<bool, uint32_t> s;
-            s = search(oprd, tid, getCacheSet(oprd));
+        if (miss) {
+            uint32_t n = __builtin_popcount(expand(miss));
+            (oprd.type == reg::OprdT::src) ? 
+                scb->trigger(stat::Event::rdMiss, n) : scb->trigger(stat::Event::wrMiss, n);
 
-            if (!s.first) {
-                (oprd.type == reg::OprdT::src) ? 
-                    scb->trigger(stat::Event::rdMiss) : scb->trigger(stat::Event::wrMiss);
+            const MissAct act = AllocOf<A>::type::miss(oprd, flags, iQueue);
+            if (act.fill)
+                fillLanes<R, Pow2>(oprd, setId, miss, act.dirty);
+            if (act.mrfRd)
+                simdBuf[2] |= std::bitset<32>(miss); // MRF.R
+            if (act.mrfWr)
+                simdBuf[3] |= std::bitset<32>(miss); // MRF.W
+        }
 
-                allocator->alloc(oprd, tid);
-            }
+        if (hit) {
+            uint32_t n = __builtin_popcount(expand(hit));
+            (oprd.type == reg::OprdT::src) ? 
+                scb->trigger(stat::Event::rdHit, n) : scb->trigger(stat::Event::wrHit, n);
 
-            else {
-                hitHandler(oprd, tid, s.second);
-            }
+            hitHandler<R, E>(oprd, hit);
         }
 
         // Synchronize warp
-        scb->trigger(stat::Event::rfcRd, bankTxCnt(simdBuf.at(0)));
-        scb->trigger(stat::Event::rfcWr, bankTxCnt(simdBuf.at(1)));
-        scb->trigger(stat::Event::mrfRd, simdBuf.at(2).count());
-        scb->trigger(stat::Event::mrfWr, simdBuf.at(3).count());
+        scb->trigger(stat::Event::rfcRd, bankTxCnt(full(simdBuf[0])));
+        scb->trigger(stat::Event::rfcWr, bankTxCnt(full(simdBuf[1])));
+        scb->trigger(stat::Event::mrfRd, full(simdBuf[2]).count());
+        scb->trigger(stat::Event::mrfWr, full(simdBuf[3]).count());
 
         flushSimdBuf();
     }
     sync();
-    return false;
 }
 
-void Rfc::hitHandler(const reg::Oprd& oprd, uint32_t tid, uint32_t idx) {
+// Threads (leaders) in hit share the operand's outcome; entries are updated per thread (hitIdx)
+template <cfg::ReplPlcy R, cfg::EvictPlcy E>
+void Rfc::hitHandler(const reg::Oprd& oprd, uint32_t hit) {
+    const std::bitset<32> hitBits(hit);
     
     if (oprd.type == reg::OprdT::src) {
-        scb->trigger(stat::Event::rdHit);
-        auto age = cfg->repl == cfg::ReplPlcy::lru ? 1 : cam->vMem[tid].at(idx).age;
-        cam->vMem[tid].at(idx).set(cam->vMem[tid].at(idx).tag, age, false);
-        simdBuf.at(0).set(tid); // RFC.R
+        constexpr bool lru = R == cfg::ReplPlcy::lru;
+        for (auto m = hit; m; m &= m - 1) {
+            uint32_t tid = __builtin_ctz(m);
+            auto e = hitIdx[tid] * 32 + tid;
+            if (lru)
+                cam->touch(e);
+            cam->dt[e] = false;
+        }
+        simdBuf[0] |= hitBits; // RFC.R
     }
     
     else if (oprd.type == reg::OprdT::dst) {
-        scb->trigger(stat::Event::wrHit);
-        simdBuf.at(1).set(tid);
+        simdBuf[1] |= hitBits;
         
-        if (cfg->ev == cfg::EvictPlcy::writeThrough) {
-            simdBuf.at(3).set(tid); // MRF.W
-            cam->vMem[tid].at(idx).set(cam->vMem[tid].at(idx).tag, 1, false);
+        constexpr bool wt = E == cfg::EvictPlcy::writeThrough;
+        if (wt)
+            simdBuf[3] |= hitBits; // MRF.W
+        if (wt || E == cfg::EvictPlcy::writeBack) {
+            for (auto m = hit; m; m &= m - 1) {
+                uint32_t tid = __builtin_ctz(m);
+                auto e = hitIdx[tid] * 32 + tid;
+                cam->touch(e);
+                cam->dt[e] = !wt;
+            }
         }
-        else if (cfg->ev == cfg::EvictPlcy::writeBack)
-            cam->vMem[tid].at(idx).set(cam->vMem[tid].at(idx).tag, 1, true);
     }
 }
 
+// The registers of the instruction are next accessed nextUse[i] instructions later (0: not in this kernel);
+// an instruction left over from the previous kernel has no annotation, so its registers count as dead
+void Rfc::noteUses(const sass::Instr & inst) {
+    constexpr uint64_t never = std::numeric_limits<uint64_t>::max();
+    tick++;
+    const auto & pool = inst.regPool();
+    for (size_t i = 0; i < pool.size(); i++) {
+        if (pool[i].type == reg::OprdT::addr)
+            continue;
+        if (pool[i].index >= regNext.size())
+            regNext.resize(pool[i].index + 1, never);
+        regNext[pool[i].index] = inst.nextUse && inst.nextUse[i] ? tick + inst.nextUse[i] : never;
+    }
+}
+
+// Next access of any register of the block
+uint64_t Rfc::blockNext(uint32_t t) const noexcept {
+    uint64_t n = std::numeric_limits<uint64_t>::max();
+    for (uint32_t r = t * cfg->nDW; r < (t + 1) * cfg->nDW && r < regNext.size(); r++)
+        n = std::min(n, regNext[r]);
+    return n;
+}
+
+// Every thread in lanes takes a block in the operand's set; dirty victims are written back
+template <cfg::ReplPlcy R, bool Pow2>
+void Rfc::fillLanes(const reg::Oprd& oprd, uint32_t setId, uint32_t lanes, bool dt) {
+    const uint32_t t = Pow2 ? oprd.index >> dwShift : oprd.index / cfg->nDW;
+    std::bitset<32> wb;
+    for (auto m = lanes; m; m &= m - 1) {
+        uint32_t tid = __builtin_ctz(m);
+        auto p = replWrapper<R>(tid, setId);
+        cam->set(tid, p.second, t, 1, dt);
+        if (p.first) wb.set(tid);
+    }
+    simdBuf[1] |= std::bitset<32>(lanes); // RFC.W
+    simdBuf[3] |= wb; // MRF.W
+}
+
+template <cfg::ReplPlcy R>
 std::pair<bool, uint32_t> Rfc::replWrapper(uint32_t tid, uint32_t setId) {
     uint32_t start = setId * cfg->assoc;
     uint32_t end = start + cfg->assoc;
+
+    // OPT: the block accessed furthest in the future (first of them)
+    if constexpr (R == cfg::ReplPlcy::opt) {
+        uint64_t far = 0;
+        uint32_t farPos = start;
+        for (auto i = start; i < end; i++) {
+            if (cam->tag[i * 32 + tid] == 256) // if empty
+                return std::make_pair<bool, uint32_t>(false, std::move(i));
+            uint64_t n = blockNext(cam->tag[i * 32 + tid]);
+            if (i == start || n > far) {
+                far = n;
+                farPos = i;
+            }
+        }
+        return std::make_pair<bool, uint32_t>(cam->dt[farPos * 32 + tid], std::move(farPos));
+    }
+
     uint32_t maxAge = 0;
     uint32_t maxPos = 0;
 
     for (auto i = start; i < end; i++) {
-        if (cam->vMem[tid].at(i).tag == 256) // if empty
+        if (cam->tag[i * 32 + tid] == 256) // if empty
             return std::make_pair<bool, uint32_t>(false, std::move(i));
 
-        if (cam->vMem[tid].at(i).age > maxAge) {
-            maxAge = cam->vMem[tid].at(i).age;
+        // Oldest timestamp, compared as ages so that a wrapping clock keeps the order
+        if (cam->age(i * 32 + tid) > maxAge) {
+            maxAge = cam->age(i * 32 + tid);
             maxPos = i;
         }
     }
 
-    return std::make_pair<bool, uint32_t>(std::move(cam->vMem[tid].at(maxPos).dt), std::move(maxPos));
+    return std::make_pair<bool, uint32_t>(cam->dt[maxPos * 32 + tid], std::move(maxPos));
 }
 
 std::ostream & operator<<(std::ostream & os, const Rfc & cc) {
-    os << *(cc.cam);
+    // Folded threads show their leader's column
+    Cam cam = *cc.cam;
+    for (auto l = cc.leaders; l; l &= l - 1) {
+        uint32_t tid = __builtin_ctz(l);
+        for (auto m = cc.cls[tid] & ~(1u << tid); m; m &= m - 1)
+            cam.copyColumn(tid, __builtin_ctz(m));
+    }
+    os << cam;
     return os;
 }
@@ -0,0 +1,463 @@
+#include "Sampling.h"
+
+#include <array>
+#include <deque>
+#include <unordered_map>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include "TraceReader.h"
+
+namespace Sampling {
+
+	namespace {
+
+		constexpr double z95 = 1.96;
+
+		// Tags of fed instructions other than unit indices
+		constexpr size_t skipTag = std::numeric_limits<size_t>::max();
+		constexpr size_t warmTag = skipTag - 1;
+
+		// splitmix64 finalizer
+		uint64_t mix(uint64_t v) noexcept {
+			v += 0x9e3779b97f4a7c15ull;
+			v = (v ^ (v >> 30)) * 0xbf58476d1ce4e5b9ull;
+			v = (v ^ (v >> 27)) * 0x94d049bb133111ebull;
+			return v ^ (v >> 31);
+		}
+
+		// Uniform in [0, 1)
+		double uniform(uint64_t v) noexcept {
+			return (mix(v) >> 11) * 0x1.0p-53;
+		}
+
+		// Unit of every fed instruction, the same for all Sims (skipTag: fast-forward), and its stratum (0); with
+		// SimPoint phases, only the strata: unit p is the representative of phase p
+		class Selector {
+		public:
+			explicit Selector(const Plan & plan) : stratum(0), plan(plan), nInst(0), nUnit(0) {
+				period = std::max<uint64_t>(plan.unitLen, std::llround(plan.unitLen / std::min(plan.fraction, 1.0)));
+				offset = mix(plan.seed) % period; // random start of the systematic sample
+				lastPeriod = std::numeric_limits<uint64_t>::max();
+				last.fill(Cta{0, skipTag});
+			}
+
+			size_t select(const sass::Instr & inst, size_t kernel) {
+				size_t u = plan.cta ? selectCta(inst, kernel) : selectInterval();
+				nInst++;
+				return u;
+			}
+
+			size_t nStrata() const noexcept {
+				return plan.phases ? plan.phases->rep.size() : 1;
+			}
+
+			// Of the units; with phases, unit p is the representative interval of phase p
+			size_t stratumOf(size_t unit) const noexcept {
+				return plan.phases ? unit : 0;
+			}
+
+			uint32_t stratum; // of the last selected instruction
+
+		private:
+			// Last CTA fed to a slot
+			struct Cta {
+				uint64_t key;
+				size_t unit;
+			};
+
+			Plan plan;
+			uint64_t nInst;
+			size_t nUnit;
+			uint64_t period, offset;
+			uint64_t lastPeriod;
+			size_t lastUnit;
+			std::array<Cta, 32> last;
+			std::unordered_map<uint64_t, size_t> ctaUnit;
+
+			// [skip | detail] in every period
+			size_t selectInterval() {
+				uint64_t p = nInst + offset;
+				if (p % period < period - plan.unitLen)
+					return skipTag;
+				if (p / period != lastPeriod) {
+					lastPeriod = p / period;
+					lastUnit = nUnit++;
+				}
+				return lastUnit;
+			}
+
+			size_t selectCta(const sass::Instr & inst, size_t kernel) {
+				uint64_t key = mix(plan.seed + kernel);
+				key = mix(key ^ static_cast<uint32_t>(inst.tbId.x));
+				key = mix(key ^ static_cast<uint32_t>(inst.tbId.y));
+				key = mix(key ^ static_cast<uint32_t>(inst.tbId.z));
+
+				auto & c = last[inst.wId % 32];
+				if (c.key != key) {
+					c.key = key;
+					c.unit = skipTag;
+					if (uniform(key) < plan.fraction) {
+						auto it = ctaUnit.find(key);
+						if (it == ctaUnit.end())
+							it = ctaUnit.emplace(key, nUnit++).first;
+						c.unit = it->second;
+					}
+				}
+				return c.unit;
+			}
+		};
+
+		struct SimState {
+			Sim * sim;
+			std::array<std::deque<size_t>, 32> tags; // of the instructions in each look-ahead window
+			using Stats = std::pair<std::shared_ptr<stat::Stat>, std::shared_ptr<stat::Stat>>; // (baseline, RFC)
+			Stats warm; // discarded
+			std::vector<Stats> units;
+			std::vector<uint64_t> baseRd, baseWr; // per stratum, of skipped instructions, then of all
+
+			SimState(Sim & sim, size_t nStrata) : sim(&sim), baseRd(nStrata, 0), baseWr(nStrata, 0) {
+				warm.first = std::make_shared<stat::Stat>(sim.cfg->eMdl);
+				warm.second = std::make_shared<stat::Stat>(sim.cfg->eMdl);
+			}
+
+			// Sim::exec, with the counters of the executed instruction going to its unit
+			void exec(const sass::Instr & inst, size_t tag) {
+				if (sim->kernelEnd)
+					return;
+				uint32_t slot = inst.wId % 32;
+				auto & rfc = sim->rfcArry.at(slot);
+				auto & q = tags[slot];
+				if (inst.opcode() != op::OP_VOID)
+					q.push_back(tag);
+
+				sass::Instr instFront;
+				auto s = rfc.slide(inst, instFront);
+				if (s != Slide::exec) {
+					sim->kernelEnd = s == Slide::end;
+					return;
+				}
+
+				size_t u = q.front();
+				q.pop_front();
+				while (u != warmTag && u >= units.size()) {
+					units.emplace_back(std::make_shared<stat::Stat>(sim->cfg->eMdl),
+						std::make_shared<stat::Stat>(sim->cfg->eMdl));
+				}
+				const auto & st = u == warmTag ? warm : units[u];
+				if (rfc.scb != st.second) {
+					rfc.scbBase = st.first;
+					rfc.scb = st.second;
+				}
+				(rfc.*rfc.kernel)(instFront);
+			}
+
+			void endKernel() {
+				const sass::Instr voidInst = sass::Instr();
+				while (!sim->kernelEnd)
+					exec(voidInst, warmTag);
+				sim->kernelEnd = false;
+			}
+
+			// Every slot's window, so that the last instructions of a representative count in its unit
+			void drainAll() {
+				sass::Instr voidInst = sass::Instr();
+				for (uint32_t slot = 0; slot < 32; slot++) {
+					voidInst.wId = slot;
+					while (!sim->kernelEnd)
+						exec(voidInst, warmTag);
+					sim->kernelEnd = false;
+				}
+			}
+		};
+
+		// Last skipped instructions of every warp slot, replayed before the slot's next measured one
+		using History = std::array<std::deque<sass::Instr>, 32>;
+
+		void skip(History & hist, const sass::Instr & inst, uint64_t warmLen) {
+			if (!warmLen)
+				return;
+			auto & h = hist[inst.wId % 32];
+			if (h.size() == warmLen)
+				h.pop_front();
+			h.push_back(inst);
+		}
+
+		// Functional warming of the instruction's slot, then the instruction in its unit
+		void measure(std::vector<SimState> & states, History & hist, const sass::Instr & inst, size_t tag, uint64_t & nWarm) {
+			auto & h = hist[inst.wId % 32];
+			for (const auto & w : h) {
+				for (auto & st : states)
+					st.exec(w, warmTag);
+			}
+			nWarm += h.size();
+			h.clear();
+			for (auto & st : states)
+				st.exec(inst, tag);
+		}
+
+		// Reads the representative of every phase, in trace order, after its warm-up; the other intervals are not
+		// read at all, their baseline comes from the profile
+		void runPhases(
+			const std::vector<std::string> & traceList,
+			const std::shared_ptr<AsmParser> & asmParser,
+			std::vector<SimState> & states,
+			const Plan & plan,
+			uint64_t & nWarm,
+			uint64_t & nDetail
+		) {
+			const auto & ph = *plan.phases;
+			ph.check(traceList);
+			const std::runtime_error mismatch("Runtime error: simpoints do not match the trace.\n");
+
+			std::unique_ptr<BaseTraceReader> traceParser;
+			size_t kernel = traceList.size();
+			auto seek = [&](const SimPoint::Pos & pos) {
+				if (!traceParser || kernel != pos.kernel) {
+					kernel = pos.kernel;
+					traceParser = TraceReaderFactory::getInstance(traceList[kernel], asmParser);
+				}
+				traceParser->seek(pos.mark);
+			};
+
+			// Next instruction, into the following kernels as the full run goes
+			auto next = [&]() {
+				while (kernel < traceList.size()) {
+					auto inst = traceParser->parse();
+					if (inst.opcode() != op::OP_VOID)
+						return inst;
+					if (!traceParser->eof()) {
+						for (auto & st : states)
+							st.exec(inst, warmTag);
+						continue;
+					}
+					for (auto & st : states)
+						st.endKernel();
+					if (++kernel < traceList.size())
+						traceParser = TraceReaderFactory::getInstance(traceList[kernel], asmParser);
+				}
+				throw mismatch;
+			};
+
+			std::vector<size_t> order(ph.rep.size());
+			for (size_t p = 0; p < order.size(); p++)
+				order[p] = p;
+			std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return ph.rep[a] < ph.rep[b]; });
+
+			History hist;
+			for (auto p : order) {
+				const uint64_t i = ph.rep[p];
+				seek(ph.warm[p]);
+				for (uint64_t n = ph.warmOf(i); n > 0; n--)
+					skip(hist, next(), plan.warmLen);
+
+				// The warm-up ends where the representative starts
+				if (kernel != ph.start[p].kernel || traceParser->mark().off != ph.start[p].mark.off)
+					throw mismatch;
+
+				for (uint64_t n = ph.lenOf(i); n > 0; n--) {
+					measure(states, hist, next(), p, nWarm);
+					nDetail++;
+				}
+				for (auto & st : states)
+					st.drainAll();
+				for (auto & h : hist)
+					h.clear();
+			}
+
+			for (auto & st : states) {
+				for (size_t j = 0; j < ph.label.size(); j++) {
+					st.baseRd[ph.label[j]] += ph.baseRd[j];
+					st.baseWr[ph.label[j]] += ph.baseWr[j];
+				}
+			}
+		}
+
+		using Counter = uint64_t stat::Stat::*;
+
+		// Stratified ratio estimator: in every stratum, sum(num) / sum(den) over its units (Cochran) times the
+		// stratum's baseline; as a ratio to the whole baseline
+		Ratio ratio(const SimState & st, const Selector & sel, Counter num, Counter den, double fpc) {
+			const double nan = std::numeric_limits<double>::quiet_NaN();
+			const auto & base = den == &stat::Stat::mrfRdNum ? st.baseRd : st.baseWr;
+			std::vector<std::vector<size_t>> members(sel.nStrata());
+			for (size_t u = 0; u < st.units.size(); u++)
+				members[sel.stratumOf(u)].push_back(u);
+
+			double est = 0, var = 0, total = 0;
+			for (size_t s = 0; s < members.size(); s++) {
+				total += base[s];
+				double sn = 0, sd = 0;
+				for (auto u : members[s]) {
+					sn += (*st.units[u].second).*num;
+					sd += (*st.units[u].first).*den;
+				}
+				size_t n = members[s].size();
+				if (sd == 0) {
+					var = base[s] ? nan : var;
+					continue;
+				}
+				double r = sn / sd;
+				est += r * base[s];
+				if (n < 2) {
+					var = nan;
+					continue;
+				}
+
+				double ss = 0;
+				for (auto u : members[s]) {
+					double e = (*st.units[u].second).*num - r * ((*st.units[u].first).*den);
+					ss += e * e;
+				}
+				double mean = sd / n;
+				var += double(base[s]) * base[s] * std::max(fpc, 0.0) * ss / (n - 1) / n / (mean * mean);
+			}
+			if (total == 0)
+				return Ratio{0, nan};
+			return Ratio{est / total, z95 * std::sqrt(var) / total};
+		}
+
+	};
+
+	std::vector<Estimate> run(
+		const std::vector<std::string> & traceList,
+		const std::shared_ptr<AsmParser> & asmParser,
+		std::vector<std::unique_ptr<Sim>> & sims,
+		const Plan & plan
+	) {
+		if (!plan.phases && (!(plan.fraction > 0) || (!plan.cta && plan.unitLen == 0)))
+			throw std::invalid_argument("Invalid input: sampling plan.\n");
+		for (auto & sim : sims) {
+			if (sim->cfg->repl == cfg::ReplPlcy::opt)
+				throw std::invalid_argument("Invalid input: OPT replacement is not supported with sampling.\n");
+		}
+
+		Selector sel(plan);
+		std::vector<SimState> states;
+		for (auto & sim : sims)
+			states.emplace_back(*sim, sel.nStrata());
+
+		uint64_t nInst = 0, nWarm = 0, nDetail = 0;
+		if (plan.phases) {
+			runPhases(traceList, asmParser, states, plan, nWarm, nDetail);
+			nInst = plan.phases->nInst;
+		}
+		else {
+			History hist;
+			for (size_t k = 0; k < traceList.size(); k++) {
+				auto traceParser = TraceReaderFactory::getInstance(traceList[k], asmParser);
+				while (!traceParser->eof()) {
+					auto inst = traceParser->parse();
+					if (inst.opcode() == op::OP_VOID && traceParser->eof())
+						break;
+					if (inst.opcode() == op::OP_VOID) {
+						for (auto & st : states)
+							st.exec(inst, warmTag);
+						continue;
+					}
+
+					nInst++;
+					size_t tag = sel.select(inst, k);
+
+					// Fast-forward: only Rfc::run's baseline, for every instruction the Sim would execute
+					if (tag == skipTag) {
+						uint64_t nAct = inst.mask.count();
+						for (const auto & oprd : inst.regPool()) {
+							if (oprd.type == reg::OprdT::addr)
+								continue;
+							for (auto & st : states) {
+								if (!st.sim->kernelEnd)
+									(oprd.type == reg::OprdT::src ? st.baseRd : st.baseWr)[sel.stratum] += nAct;
+							}
+						}
+						skip(hist, inst, plan.warmLen);
+						continue;
+					}
+
+					// Functional warming; these instructions are already in the baseline
+					nDetail++;
+					measure(states, hist, inst, tag, nWarm);
+				}
+				for (auto & st : states)
+					st.endKernel();
+			}
+
+			// Executed measured instructions count towards the baseline in their units
+			for (auto & st : states) {
+				for (size_t u = 0; u < st.units.size(); u++) {
+					st.baseRd[sel.stratumOf(u)] += st.units[u].first->mrfRdNum;
+					st.baseWr[sel.stratumOf(u)] += st.units[u].first->mrfWrNum;
+				}
+			}
+		}
+
+		std::vector<Estimate> estimates;
+		const double fpc = 1 - double(nDetail) / std::max<uint64_t>(nInst, 1); // finite population correction
+		for (auto & st : states) {
+			auto & sim = *st.sim;
+			for (auto & rfc : sim.rfcArry) {
+				rfc.scbBase = sim.scbBase;
+				rfc.scb = sim.scb;
+			}
+
+			for (size_t s = 0; s < sel.nStrata(); s++) {
+				sim.scbBase->mrfRdNum += st.baseRd[s];
+				sim.scbBase->mrfWrNum += st.baseWr[s];
+			}
+
+			// RFC counter, baseline counter it is estimated against
+			const std::pair<Counter, Counter> counters[] = {
+				{&stat::Stat::rfcRdHitNum, &stat::Stat::mrfRdNum},
+				{&stat::Stat::rfcRdMissNum, &stat::Stat::mrfRdNum},
+				{&stat::Stat::rfcWrHitNum, &stat::Stat::mrfWrNum},
+				{&stat::Stat::rfcWrMissNum, &stat::Stat::mrfWrNum},
+				{&stat::Stat::rfcRdNum, &stat::Stat::mrfRdNum},
+				{&stat::Stat::rfcWrNum, &stat::Stat::mrfWrNum},
+				{&stat::Stat::mrfRdNum, &stat::Stat::mrfRdNum},
+				{&stat::Stat::mrfWrNum, &stat::Stat::mrfWrNum},
+			};
+			for (const auto & c : counters) {
+				double total = c.second == &stat::Stat::mrfRdNum ? sim.scbBase->mrfRdNum : sim.scbBase->mrfWrNum;
+				(*sim.scb).*c.first += std::llround(ratio(st, sel, c.first, c.second, fpc).value * total);
+			}
+
+			estimates.push_back(Estimate{
+				st.units.size(), nInst, nWarm, nDetail,
+				ratio(st, sel, &stat::Stat::rfcRdHitNum, &stat::Stat::mrfRdNum, fpc),
+				ratio(st, sel, &stat::Stat::rfcWrHitNum, &stat::Stat::mrfWrNum, fpc),
+				ratio(st, sel, &stat::Stat::mrfRdNum, &stat::Stat::mrfRdNum, fpc),
+				ratio(st, sel, &stat::Stat::mrfWrNum, &stat::Stat::mrfWrNum, fpc)
+			});
+		}
+		return estimates;
+	}
+
+	void report(std::ostream & os, const Estimate & e, const Plan & plan) {
+		auto pct = [](const Ratio & r) {
+			std::string s = std::to_string(r.value * 100) + "%";
+			return std::isnan(r.halfWidth) ? s + " +- n/a" : s + " +- " + std::to_string(r.halfWidth * 100);
+		};
+		double nInst = std::max<uint64_t>(e.nInst, 1);
+
+		os << "\t(Sampled units, Measured, Warming) -> (" << e.nUnit << ", "
+		   << e.nDetail / nInst * 100 << "\%, " << e.nWarm / nInst * 100 << "\%)\n";
+		os << "\t(Read-hit Rate, Write-hit Rate) -> (" << pct(e.rdHit) << ", " << pct(e.wrHit) << ") at 95\% confidence\n";
+		os << "\t(MRF.R, MRF.W / baseline) -> (" << pct(e.mrfRd) << ", " << pct(e.mrfWr) << ")\n";
+
+		// Half-widths go as sqrt((1 - f) / f) of the measured fraction f
+		if (plan.margin > 0) {
+			double hw = std::max(e.rdHit.halfWidth, e.wrHit.halfWidth) * 100;
+			double f = std::min(plan.fraction, 1.0);
+			if (std::isnan(hw))
+				os << "\t(Target) -> too few units for a confidence interval\n";
+			else if (hw <= plan.margin)
+				os << "\t(Target) -> +-" << plan.margin << " met\n";
+			else
+				os << "\t(Target) -> +-" << plan.margin << " missed, try a fraction of "
+				   << 1 / (1 + (1 - f) / f * (plan.margin / hw) * (plan.margin / hw)) << "\n";
+		}
+	}
+
+};
@@ -0,0 +1,436 @@
+#include "Sim.h"
+
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <array>
+
+#include "TraceReader.h"
+#include "BcastRing.h"
+#include "ThreadPool.h"
+#include "LaneSetSim.h"
+#include "NextUse.h"
+
+Sim::Sim(const std::shared_ptr<cfg::GlobalCfg> & cfg) : cfg(cfg), kernelEnd(false) {
+	scbBase = std::make_shared<stat::Stat>(cfg->eMdl);
+	scb = std::make_shared<stat::Stat>(cfg->eMdl);
+
+	// Initialize RFC instance for each warp on SM core (e.g., for TU102, 4 sub-core * 8 warps = 32)
+	rfcArry.reserve(32);
+	for (auto i = 0; i < 32; i++)
+		rfcArry.emplace_back(cfg, scbBase, scb);
+}
+
+// Instructions after the kernel has been drained (i.e., after a VOID) are ignored
+void Sim::exec(const sass::Instr & inst) {
+	if (!kernelEnd)
+		kernelEnd = rfcArry.at(inst.wId % 32).exec(inst);
+}
+
+// End of the kernel trace: keep feeding VOID until the window is drained. Instructions left in the other
+// windows run in the next kernel, past the lifetime of their next-use annotation
+void Sim::endKernel() {
+	const sass::Instr voidInst = sass::Instr();
+	while (!kernelEnd)
+		kernelEnd = rfcArry.at(voidInst.wId % 32).exec(voidInst);
+	kernelEnd = false;
+	if (cfg->repl == cfg::ReplPlcy::opt) {
+		for (auto & rfc : rfcArry)
+			rfc.iQueue.dropNextUse();
+	}
+}
+
+// Every warp slot's window is drained, for kernels simulated on their own (-k, sweep), where the RFC is
+// flushed afterwards and the instructions left by endKernel would be lost
+void Sim::drainAll() {
+	const sass::Instr voidInst = sass::Instr();
+	for (auto & rfc : rfcArry) {
+		while (!rfc.exec(voidInst));
+	}
+	kernelEnd = false;
+	if (cfg->repl == cfg::ReplPlcy::opt) {
+		for (auto & rfc : rfcArry)
+			rfc.iQueue.dropNextUse();
+	}
+}
+
+// Back to a cold RFC; the scoreboards are kept
+void Sim::flush() {
+	for (auto & rfc : rfcArry)
+		rfc.flush();
+	kernelEnd = false;
+}
+
+void Sim::shard() {
+	for (auto & rfc : rfcArry) {
+		rfc.scbBase = std::make_shared<stat::Stat>(cfg->eMdl);
+		rfc.scb = std::make_shared<stat::Stat>(cfg->eMdl);
+	}
+}
+
+void Sim::unshard() {
+	for (auto & rfc : rfcArry) {
+		if (rfc.scbBase != scbBase)
+			scbBase->merge(*rfc.scbBase);
+		if (rfc.scb != scb)
+			scb->merge(*rfc.scb);
+		rfc.scbBase = scbBase;
+		rfc.scb = scb;
+	}
+}
+
+void Sim::report(std::ostream & os) const {
+	os << *scbBase << std::endl;
+	os << *scb << std::endl;
+	stat::Stat::printCmp(*scbBase, *scb);
+}
+
+namespace {
+
+	// Look-ahead window occupancy of each warp slot, following the window handling of Rfc::exec, so that the
+	// router knows which instruction ends a kernel (and which are dropped after it) without simulating
+	struct WinTracker {
+		uint32_t wl;
+		std::array<size_t, 32> occ;
+		bool kernelEnd;
+
+		explicit WinTracker(const Sim & sim) : wl(sim.cfg->wl), kernelEnd(sim.kernelEnd) {
+			for (size_t i = 0; i < 32; i++)
+				occ[i] = sim.rfcArry[i].iQueue.size();
+		}
+
+		// Same value as Rfc::exec
+		bool step(uint32_t slot, const sass::Instr & inst) noexcept {
+			auto & n = occ[slot];
+			if (inst.opcode() == op::OP_VOID) {
+				if (wl == 0 || n == 0)
+					return true;
+				n--;
+			} else if (n < wl) {
+				n++;
+			}
+			return false;
+		}
+	};
+
+	// OPT replacement needs whole kernels, annotated with next uses, before simulating them
+	bool needsNextUse(const std::vector<std::unique_ptr<Sim>> & sims) {
+		return std::any_of(sims.begin(), sims.end(), [](const std::unique_ptr<Sim> & sim) {
+			return sim->cfg->repl == cfg::ReplPlcy::opt;
+		});
+	}
+
+	void rejectNextUse(const std::vector<std::unique_ptr<Sim>> & sims) {
+		if (needsNextUse(sims))
+			throw std::invalid_argument("Invalid input: OPT replacement is only supported by the serial and -k modes.\n");
+	}
+
+	// Calls f on every instruction of the kernel trace; with next uses, the annotated kernel is decoded into the
+	// caller's buffer, which must outlive the drain of the windows (endKernel)
+	template <typename F>
+	void forEachInst(const std::string & traceFile, const std::shared_ptr<AsmParser> & asmParser, NextUse::Kernel * kernel, F f) {
+		if (kernel) {
+			NextUse::load(traceFile, asmParser, *kernel);
+			for (const auto & inst : kernel->insts)
+				f(inst);
+			return;
+		}
+		auto traceParser = TraceReaderFactory::getInstance(traceFile, asmParser);
+		while (!traceParser->eof()) {
+			auto inst = traceParser->parse();
+			if (inst.opcode() == op::OP_VOID && traceParser->eof())
+				break;
+			f(inst);
+		}
+	}
+
+};
+
+namespace SimDriver {
+
+	void run(
+		const std::vector<std::string> & traceList,
+		const std::shared_ptr<AsmParser> & asmParser,
+		std::vector<std::unique_ptr<Sim>> & sims
+	) {
+		NextUse::Kernel kernel;
+		NextUse::Kernel * nextUse = needsNextUse(sims) ? &kernel : nullptr;
+		for (auto & traceFile : traceList) {
+			forEachInst(traceFile, asmParser, nextUse, [&](const sass::Instr & inst) {
+				for (auto & sim : sims)
+					sim->exec(inst);
+			});
+			for (auto & sim : sims)
+				sim->endKernel();
+		}
+	}
+
+	void runPipelined(
+		const std::vector<std::string> & traceList,
+		const std::shared_ptr<AsmParser> & asmParser,
+		std::vector<std::unique_ptr<Sim>> & sims
+	) {
+		constexpr size_t ringSize = 4096;
+		constexpr uint64_t maxBatch = 256; // consumers release slots at least this often
+
+		rejectNextUse(sims);
+		BcastRing<TracePkt> ring(ringSize, sims.size());
+		std::vector<std::exception_ptr> errs(sims.size() + 1);
+
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < sims.size(); i++) {
+			workers.emplace_back([&, i] {
+				auto & sim = *sims[i];
+				try {
+					uint64_t pos = 0;
+					while (true) {
+						auto end = ring.wait(pos);
+						if (end == pos)
+							break; // closed and drained
+						end = std::min(end, pos + maxBatch);
+						for (; pos < end; pos++) {
+							const auto & pkt = ring.at(pos);
+							if (pkt.kernelEnd)
+								sim.endKernel();
+							else
+								sim.exec(pkt.inst);
+						}
+						ring.release(i, pos);
+					}
+				} catch (...) {
+					errs[i] = std::current_exception();
+					ring.detach(i);
+				}
+			});
+		}
+
+		// Parser (producer) runs on the calling thread
+		try {
+			for (auto & traceFile : traceList) {
+				auto traceParser = TraceReaderFactory::getInstance(traceFile, asmParser);
+				while (!traceParser->eof()) {
+					auto inst = traceParser->parse();
+					if (inst.opcode() == op::OP_VOID && traceParser->eof())
+						break;
+					auto & pkt = ring.claim();
+					pkt.inst = std::move(inst);
+					pkt.kernelEnd = false;
+					ring.publish();
+				}
+				auto & pkt = ring.claim();
+				pkt.kernelEnd = true;
+				ring.publish();
+			}
+		} catch (...) {
+			errs.back() = std::current_exception();
+		}
+		ring.close();
+
+		for (auto & w : workers)
+			w.join();
+		for (auto & e : errs) {
+			if (e)
+				std::rethrow_exception(e);
+		}
+	}
+
+	void runKernelParallel(
+		const std::vector<std::string> & traceList,
+		const std::shared_ptr<AsmParser> & asmParser,
+		std::vector<std::unique_ptr<Sim>> & sims,
+		size_t nThreads
+	) {
+		ThreadPool pool(std::min(nThreads, traceList.size()));
+		const bool nextUse = needsNextUse(sims);
+
+		// Each worker reuses its own Sim per config, flushed before every kernel
+		std::vector<std::vector<std::unique_ptr<Sim>>> workerSims(pool.size());
+		for (auto & ws : workerSims) {
+			for (auto & sim : sims)
+				ws.push_back(std::make_unique<Sim>(sim->cfg));
+		}
+
+		// (baseline, RFC) statistics per kernel and config
+		std::vector<std::vector<std::pair<stat::Stat, stat::Stat>>> kernelStats(traceList.size());
+
+		for (size_t k = 0; k < traceList.size(); k++) {
+			pool.submit([&, k](size_t wk) {
+				auto & ws = workerSims[wk];
+				for (auto & sim : ws) {
+					sim->flush();
+					sim->scbBase->clear();
+					sim->scb->clear();
+				}
+
+				NextUse::Kernel kernel;
+				forEachInst(traceList[k], asmParser, nextUse ? &kernel : nullptr, [&](const sass::Instr & inst) {
+					for (auto & sim : ws)
+						sim->exec(inst);
+				});
+
+				for (auto & sim : ws) {
+					sim->drainAll();
+					kernelStats[k].emplace_back(*sim->scbBase, *sim->scb);
+				}
+			});
+		}
+		pool.wait();
+
+		for (auto & ks : kernelStats) {
+			for (size_t i = 0; i < sims.size(); i++) {
+				sims[i]->scbBase->merge(ks[i].first);
+				sims[i]->scb->merge(ks[i].second);
+			}
+		}
+	}
+
+	void runSlotParallel(
+		const std::vector<std::string> & traceList,
+		const std::shared_ptr<AsmParser> & asmParser,
+		std::vector<std::unique_ptr<Sim>> & sims,
+		size_t nThreads
+	) {
+		constexpr size_t ringSize = 4096;
+		constexpr uint64_t maxBatch = 256; // consumers release slots at least this often
+
+		if (sims.size() > 64)
+			throw std::invalid_argument("Invalid input: at most 64 configs per warp-slot parallel run.\n");
+		rejectNextUse(sims);
+
+		const size_t nWorkers = std::max<size_t>(1, std::min<size_t>(nThreads, 32));
+		std::vector<std::unique_ptr<BcastRing<SlotPkt>>> rings;
+		for (size_t w = 0; w < nWorkers; w++)
+			rings.push_back(std::make_unique<BcastRing<SlotPkt>>(ringSize, 1));
+		std::vector<std::exception_ptr> errs(nWorkers + 1);
+
+		std::vector<WinTracker> trackers;
+		for (auto & sim : sims) {
+			sim->shard();
+			trackers.emplace_back(*sim);
+		}
+
+		std::vector<std::thread> workers;
+		for (size_t w = 0; w < nWorkers; w++) {
+			workers.emplace_back([&, w] {
+				auto & ring = *rings[w];
+				try {
+					uint64_t pos = 0;
+					while (true) {
+						auto end = ring.wait(pos);
+						if (end == pos)
+							break; // closed and drained
+						end = std::min(end, pos + maxBatch);
+						for (; pos < end; pos++) {
+							const auto & pkt = ring.at(pos);
+							for (auto m = pkt.simMask; m; m &= m - 1)
+								sims[__builtin_ctzll(m)]->rfcArry[pkt.slot].exec(pkt.inst);
+						}
+						ring.release(0, pos);
+					}
+				} catch (...) {
+					errs[w] = std::current_exception();
+					ring.detach(0);
+				}
+			});
+		}
+
+		auto route = [&](const sass::Instr & inst, uint64_t simMask) {
+			uint32_t slot = inst.wId % 32;
+			auto & pkt = rings[slot % nWorkers]->claim();
+			pkt.inst = inst;
+			pkt.slot = slot;
+			pkt.simMask = simMask;
+			rings[slot % nWorkers]->publish();
+		};
+
+		// Parser and router run on the calling thread
+		try {
+			for (auto & traceFile : traceList) {
+				auto traceParser = TraceReaderFactory::getInstance(traceFile, asmParser);
+				while (!traceParser->eof()) {
+					auto inst = traceParser->parse();
+					if (inst.opcode() == op::OP_VOID && traceParser->eof())
+						break;
+					uint64_t simMask = 0;
+					for (size_t i = 0; i < sims.size(); i++) {
+						auto & t = trackers[i];
+						if (t.kernelEnd)
+							continue;
+						simMask |= uint64_t(1) << i;
+						t.kernelEnd = t.step(inst.wId % 32, inst);
+					}
+					if (simMask)
+						route(inst, simMask);
+				}
+
+				// Sim::endKernel, one VOID at a time
+				const sass::Instr voidInst = sass::Instr();
+				for (size_t i = 0; i < sims.size(); i++) {
+					auto & t = trackers[i];
+					while (!t.kernelEnd) {
+						route(voidInst, uint64_t(1) << i);
+						t.kernelEnd = t.step(voidInst.wId % 32, voidInst);
+					}
+					t.kernelEnd = false;
+				}
+			}
+		} catch (...) {
+			errs.back() = std::current_exception();
+		}
+		for (auto & ring : rings)
+			ring->close();
+
+		for (auto & w : workers)
+			w.join();
+		for (auto & sim : sims)
+			sim->unshard();
+		for (auto & e : errs) {
+			if (e)
+				std::rethrow_exception(e);
+		}
+	}
+
+	void runLaneSet(
+		const std::vector<std::string> & traceList,
+		const std::shared_ptr<AsmParser> & asmParser,
+		std::vector<std::unique_ptr<Sim>> & sims,
+		size_t nThreads
+	) {
+		constexpr size_t batchSize = 1 << 20; // buffered accesses per batch, per Sim
+
+		rejectNextUse(sims);
+		ThreadPool pool(nThreads);
+		std::vector<std::unique_ptr<LaneSetSim>> engines;
+		for (auto & sim : sims)
+			engines.push_back(std::make_unique<LaneSetSim>(*sim));
+
+		auto simulate = [&] {
+			for (auto & e : engines)
+				e->submit(pool);
+			pool.wait();
+			for (auto & e : engines)
+				e->clear();
+		};
+
+		for (auto & traceFile : traceList) {
+			auto traceParser = TraceReaderFactory::getInstance(traceFile, asmParser);
+			while (!traceParser->eof()) {
+				auto inst = traceParser->parse();
+				if (inst.opcode() == op::OP_VOID && traceParser->eof())
+					break;
+				for (auto & e : engines) {
+					e->exec(inst);
+					if (e->pending() >= batchSize)
+						simulate();
+				}
+			}
+			for (auto & e : engines)
+				e->endKernel();
+		}
+		simulate();
+
+		for (auto & e : engines)
+			e->finish();
+	}
+
+};
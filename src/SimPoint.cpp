@@ -0,0 +1,350 @@
+#include "SimPoint.h"
+
+#include <fstream>
+#include <unordered_map>
+#include <random>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+
+namespace SimPoint {
+
+	namespace {
+
+		// splitmix64 finalizer
+		uint64_t mix(uint64_t v) noexcept {
+			v += 0x9e3779b97f4a7c15ull;
+			v = (v ^ (v >> 30)) * 0xbf58476d1ce4e5b9ull;
+			v = (v ^ (v >> 27)) * 0x94d049bb133111ebull;
+			return v ^ (v >> 31);
+		}
+
+		struct Clustering {
+			std::vector<uint32_t> label;
+			std::vector<double> center; // k x dims
+			double sse;
+		};
+
+		double dist2(const double * a, const double * b, uint32_t dims) noexcept {
+			double s = 0;
+			for (uint32_t d = 0; d < dims; d++)
+				s += (a[d] - b[d]) * (a[d] - b[d]);
+			return s;
+		}
+
+		// Lloyd's algorithm from a k-means++ seeding; an emptied cluster takes the point furthest from its center
+		Clustering kmeans(const std::vector<double> & pts, uint32_t dims, uint32_t k, std::mt19937_64 & rng) {
+			const size_t n = pts.size() / dims;
+			Clustering c{std::vector<uint32_t>(n, 0), std::vector<double>(size_t(k) * dims, 0), 0};
+
+			std::vector<double> near(n, std::numeric_limits<double>::max());
+			size_t pick = std::uniform_int_distribution<size_t>(0, n - 1)(rng);
+			for (uint32_t j = 0; j < k; j++) {
+				std::copy(&pts[pick * dims], &pts[pick * dims] + dims, &c.center[j * dims]);
+				double sum = 0;
+				for (size_t i = 0; i < n; i++) {
+					near[i] = std::min(near[i], dist2(&pts[i * dims], &c.center[j * dims], dims));
+					sum += near[i];
+				}
+				if (sum == 0)
+					continue; // fewer distinct points than clusters
+				double r = std::uniform_real_distribution<double>(0, sum)(rng);
+				for (pick = 0; pick + 1 < n && (r -= near[pick]) > 0; pick++);
+			}
+
+			std::vector<size_t> size(k);
+			for (int it = 0; it < 100; it++) {
+				bool moved = false;
+				c.sse = 0;
+				for (size_t i = 0; i < n; i++) {
+					uint32_t best = 0;
+					double bestD = std::numeric_limits<double>::max();
+					for (uint32_t j = 0; j < k; j++) {
+						double d = dist2(&pts[i * dims], &c.center[j * dims], dims);
+						if (d < bestD) {
+							bestD = d;
+							best = j;
+						}
+					}
+					moved |= it == 0 || c.label[i] != best;
+					c.label[i] = best;
+					c.sse += bestD;
+				}
+				if (!moved)
+					break;
+
+				std::fill(c.center.begin(), c.center.end(), 0);
+				std::fill(size.begin(), size.end(), 0);
+				for (size_t i = 0; i < n; i++) {
+					size[c.label[i]]++;
+					for (uint32_t d = 0; d < dims; d++)
+						c.center[c.label[i] * dims + d] += pts[i * dims + d];
+				}
+				for (uint32_t j = 0; j < k; j++) {
+					for (uint32_t d = 0; size[j] && d < dims; d++)
+						c.center[j * dims + d] /= size[j];
+				}
+
+				// Reseeded once every center is a mean; the taken point moves to its new cluster, so that two
+				// empty clusters do not take the same point
+				for (uint32_t j = 0; j < k; j++) {
+					if (size[j])
+						continue;
+					size_t far = 0;
+					double farD = -1;
+					for (size_t i = 0; i < n; i++) {
+						if (size[c.label[i]] < 2)
+							continue;
+						double d = dist2(&pts[i * dims], &c.center[c.label[i] * dims], dims);
+						if (d > farD) {
+							farD = d;
+							far = i;
+						}
+					}
+					if (farD < 0)
+						continue; // fewer points than clusters
+					std::copy(&pts[far * dims], &pts[far * dims] + dims, &c.center[j * dims]);
+					size[c.label[far]]--;
+					size[j]++;
+					c.label[far] = j;
+				}
+			}
+			return c;
+		}
+
+		// Bayesian information criterion of a clustering as a spherical Gaussian mixture (X-means)
+		double bic(const Clustering & c, uint32_t dims, uint32_t k) {
+			const double n = c.label.size();
+			if (n <= k)
+				return -std::numeric_limits<double>::infinity();
+			std::vector<size_t> size(k, 0);
+			for (auto l : c.label)
+				size[l]++;
+
+			double var = std::max(c.sse / (dims * (n - k)), 1e-12);
+			double ll = -n * dims / 2 * std::log(2 * M_PI * var) - c.sse / (2 * var);
+			for (auto s : size) {
+				if (s)
+					ll += s * std::log(s / n);
+			}
+			return ll - k * (dims + 1.0) / 2 * std::log(n);
+		}
+
+		std::ostream & operator<<(std::ostream & os, const Pos & p) {
+			const auto & m = p.mark;
+			return os << p.kernel << " " << m.off << " " << m.kernelOff << " " << m.nDef << " " << m.blockId.x << " "
+					  << m.blockId.y << " " << m.blockId.z << " " << m.wId << " " << m.pc;
+		}
+
+		std::istream & operator>>(std::istream & is, Pos & p) {
+			auto & m = p.mark;
+			return is >> p.kernel >> m.off >> m.kernelOff >> m.nDef >> m.blockId.x >> m.blockId.y >> m.blockId.z
+					  >> m.wId >> m.pc;
+		}
+
+	};
+
+	uint64_t Phases::lenOf(uint64_t interval) const noexcept {
+		return std::min(intervalLen, nInst - interval * intervalLen);
+	}
+
+	uint64_t Phases::warmOf(uint64_t interval) const noexcept {
+		return interval ? warmLen : 0;
+	}
+
+	void Phases::check(const std::vector<std::string> & traceList) const {
+		bool same = traceList.size() == traceSize.size();
+		for (size_t k = 0; same && k < traceList.size(); k++) {
+			std::error_code ec;
+			same = std::filesystem::file_size(traceList[k], ec) == traceSize[k] && !ec;
+		}
+		if (!same)
+			throw std::runtime_error("Runtime error: simpoints do not match the trace.\n");
+	}
+
+	void Phases::save(const std::string & path) const {
+		std::ofstream of(path);
+		if (!of.is_open())
+			throw std::runtime_error("Runtime error: failed to write simpoint file.\n");
+		of.precision(17);
+		of << "simpoints v2 " << intervalLen << " " << warmLen << " " << nInst << " " << traceSize.size() << " "
+		   << rep.size() << " " << label.size() << "\n";
+		for (size_t k = 0; k < traceSize.size(); k++)
+			of << traceSize[k] << (k + 1 == traceSize.size() || k % 16 == 15 ? "\n" : " ");
+		for (size_t p = 0; p < rep.size(); p++)
+			of << rep[p] << " " << weight[p] << " " << warm[p] << " " << start[p] << "\n";
+		for (size_t i = 0; i < label.size(); i++)
+			of << label[i] << " " << baseRd[i] << " " << baseWr[i] << "\n";
+		if (!of)
+			throw std::runtime_error("Runtime error: failed to write simpoint file.\n");
+	}
+
+	void Phases::load(const std::string & path) {
+		std::ifstream ifs(path);
+		std::string magic, version;
+		size_t nKernel = 0, nPhase = 0, nInterval = 0;
+		if (!(ifs >> magic) || magic != "simpoints")
+			throw std::runtime_error("Runtime error: failed to parse simpoint file.\n");
+		if (!(ifs >> version) || version != "v2")
+			throw std::runtime_error("Runtime error: simpoint file of an older version, remove it to profile the trace again.\n");
+		if (!(ifs >> intervalLen >> warmLen >> nInst >> nKernel >> nPhase >> nInterval) || intervalLen == 0
+			|| warmLen > intervalLen || nInterval != (nInst + intervalLen - 1) / intervalLen)
+			throw std::runtime_error("Runtime error: failed to parse simpoint file.\n");
+
+		traceSize.resize(nKernel);
+		for (auto & s : traceSize)
+			ifs >> s;
+		rep.resize(nPhase);
+		weight.resize(nPhase);
+		warm.resize(nPhase);
+		start.resize(nPhase);
+		for (size_t p = 0; p < nPhase; p++)
+			ifs >> rep[p] >> weight[p] >> warm[p] >> start[p];
+		label.resize(nInterval);
+		baseRd.resize(nInterval);
+		baseWr.resize(nInterval);
+		for (size_t i = 0; i < nInterval; i++)
+			ifs >> label[i] >> baseRd[i] >> baseWr[i];
+		if (!ifs)
+			throw std::runtime_error("Runtime error: failed to parse simpoint file.\n");
+		for (size_t p = 0; p < nPhase; p++) {
+			if (rep[p] >= nInterval || label[rep[p]] != p || warm[p].kernel >= nKernel || start[p].kernel >= nKernel)
+				throw std::runtime_error("Runtime error: failed to parse simpoint file.\n");
+		}
+		for (auto l : label) {
+			if (l >= nPhase)
+				throw std::runtime_error("Runtime error: failed to parse simpoint file.\n");
+		}
+	}
+
+	Phases profile(const std::vector<std::string> & traceList, const std::shared_ptr<AsmParser> & asmParser, const Options & opt) {
+		if (opt.intervalLen == 0 || opt.maxPhases == 0 || opt.dims == 0)
+			throw std::invalid_argument("Invalid input: simpoint options.\n");
+		const uint32_t dims = opt.dims;
+
+		// Static instructions get ids in order of appearance, each with a fixed random direction in [-1, 1)^dims
+		std::unordered_map<const sass::StaticInstr *, uint32_t> ids;
+		std::vector<double> dir;
+		std::vector<uint32_t> cnt; // per id, in the current interval
+		std::vector<uint32_t> touched;
+
+		std::vector<double> pts; // projected frequency vector of every interval
+		std::vector<uint64_t> len, baseRd, baseWr;
+		std::vector<Pos> starts, warms; // of every interval and of its warm-up
+		const uint64_t warmLen = std::min(opt.warmLen, opt.intervalLen);
+		uint64_t n = 0, pos = 0, rd = 0, wr = 0;
+		auto close = [&] {
+			if (n == 0)
+				return;
+			size_t base = pts.size();
+			pts.resize(base + dims, 0);
+			for (auto id : touched) {
+				double f = double(cnt[id]) / n;
+				for (uint32_t d = 0; d < dims; d++)
+					pts[base + d] += f * dir[size_t(id) * dims + d];
+				cnt[id] = 0;
+			}
+			touched.clear();
+			len.push_back(n);
+			baseRd.push_back(rd);
+			baseWr.push_back(wr);
+			n = rd = wr = 0;
+		};
+
+		std::vector<uint64_t> traceSize;
+		for (size_t k = 0; k < traceList.size(); k++) {
+			traceSize.push_back(std::filesystem::file_size(traceList[k]));
+			auto traceParser = TraceReaderFactory::getInstance(traceList[k], asmParser);
+			while (!traceParser->eof()) {
+				// Positions are taken before the first instruction of their interval or warm-up
+				if (pos % opt.intervalLen == 0 && starts.size() == pos / opt.intervalLen)
+					starts.push_back(Pos{k, traceParser->mark()});
+				if (pos == 0 && warms.empty())
+					warms.push_back(Pos{k, traceParser->mark()}); // the first interval has none
+				if ((pos + warmLen) % opt.intervalLen == 0 && warms.size() == (pos + warmLen) / opt.intervalLen)
+					warms.push_back(Pos{k, traceParser->mark()});
+
+				auto inst = traceParser->parse();
+				if (inst.opcode() == op::OP_VOID)
+					continue;
+				pos++;
+
+				// As Rfc::run counts the baseline
+				uint64_t nAct = inst.mask.count();
+				for (const auto & oprd : inst.regPool()) {
+					if (oprd.type != reg::OprdT::addr)
+						(oprd.type == reg::OprdT::src ? rd : wr) += nAct;
+				}
+
+				auto it = ids.emplace(inst.si, static_cast<uint32_t>(ids.size())).first;
+				uint32_t id = it->second;
+				if (id == cnt.size()) {
+					cnt.push_back(0);
+					for (uint32_t d = 0; d < dims; d++)
+						dir.push_back((mix(opt.seed ^ (uint64_t(id) * dims + d)) >> 11) * 0x1.0p-52 - 1);
+				}
+				if (cnt[id]++ == 0)
+					touched.push_back(id);
+				if (++n == opt.intervalLen)
+					close();
+			}
+		}
+		close();
+
+		Phases ph;
+		ph.intervalLen = opt.intervalLen;
+		ph.warmLen = warmLen;
+		ph.nInst = pos;
+		ph.traceSize = std::move(traceSize);
+		ph.baseRd = std::move(baseRd);
+		ph.baseWr = std::move(baseWr);
+		if (len.empty())
+			return ph;
+
+		// Smallest k within 90% of the BIC range
+		std::mt19937_64 rng(opt.seed);
+		const uint32_t maxK = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(opt.maxPhases, len.size() - 1)));
+		std::vector<Clustering> runs;
+		std::vector<double> score;
+		for (uint32_t k = 1; k <= maxK; k++) {
+			runs.push_back(kmeans(pts, dims, k, rng));
+			score.push_back(bic(runs.back(), dims, k));
+		}
+		auto [lo, hi] = std::minmax_element(score.begin(), score.end());
+		size_t best = 0;
+		while (best + 1 < score.size() && score[best] < *lo + 0.9 * (*hi - *lo))
+			best++;
+		const auto & c = runs[best];
+
+		// Phases in order of first appearance; each is represented by the interval closest to its center
+		const uint32_t k = best + 1;
+		std::vector<uint32_t> phaseOf(k, UINT32_MAX);
+		std::vector<double> repD;
+		ph.label.resize(len.size());
+		for (size_t i = 0; i < len.size(); i++) {
+			uint32_t j = c.label[i];
+			if (phaseOf[j] == UINT32_MAX) {
+				phaseOf[j] = static_cast<uint32_t>(ph.rep.size());
+				ph.rep.push_back(i);
+				ph.weight.push_back(0);
+				ph.warm.emplace_back();
+				ph.start.emplace_back();
+				repD.push_back(std::numeric_limits<double>::max());
+			}
+			uint32_t p = phaseOf[j];
+			ph.label[i] = p;
+			ph.weight[p] += double(len[i]) / ph.nInst;
+			double d = dist2(&pts[i * dims], &c.center[j * dims], dims);
+			if (d < repD[p]) {
+				repD[p] = d;
+				ph.rep[p] = i;
+				ph.warm[p] = warms[i];
+				ph.start[p] = starts[i];
+			}
+		}
+		return ph;
+	}
+
+};
@@ -0,0 +1,207 @@
+#include "StackDist.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "TraceReader.h"
+
+namespace StackDist {
+
+	namespace {
+		constexpr uint32_t inf = std::numeric_limits<uint32_t>::max();
+
+		uint32_t reverseBits(uint32_t v) noexcept {
+			v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+			v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+			v = ((v >> 4) & 0x0f0f0f0fu) | ((v & 0x0f0f0f0fu) << 4);
+			v = ((v >> 8) & 0x00ff00ffu) | ((v & 0x00ff00ffu) << 8);
+			return (v >> 16) | (v << 16);
+		}
+	};
+
+	Analyzer::Analyzer(const cfg::GlobalCfg & cfg, uint32_t maxSet, uint32_t maxAssoc)
+		: cfg(cfg), maxAssoc(maxAssoc) {
+		if (maxSet == 0 || maxAssoc == 0 || cfg.nDW == 0)
+			throw std::invalid_argument("Invalid input: stack distance limits.\n");
+		for (uint32_t nSet = 1; nSet <= maxSet; nSet *= 2) {
+			Level l;
+			l.nSet = nSet;
+			l.n.assign(32 * 32 * nSet, 0);
+			l.tag.assign(32 * 32 * nSet * maxAssoc, 0);
+			l.hold.assign(32 * 32 * nSet * maxAssoc, 0);
+			l.dirty.assign(32 * 32 * nSet * maxAssoc, 0);
+			l.rd.assign(maxAssoc + 2, 0);
+			l.wr.assign(maxAssoc + 2, 0);
+			l.wb.assign(maxAssoc + 2, 0);
+			levels.push_back(std::move(l));
+		}
+		cnt.assign(maxAssoc + 2, 0);
+	}
+
+	// Smallest associativity holding the tag; inf if none tracked does
+	uint32_t Analyzer::holdOf(const Level & l, size_t st, uint32_t tag) const noexcept {
+		const uint32_t * t = &l.tag[st * maxAssoc];
+		for (uint32_t i = 0; i < l.n[st]; i++) {
+			if (t[i] == tag)
+				return l.hold[st * maxAssoc + i];
+		}
+		return inf;
+	}
+
+	// Rfc::hitHandler / WriteAllocator: a read refreshes the block where it hits and leaves it clean, a miss
+	// bypasses the cache; a write takes the block in every size, dirty where it missed (write-through) or
+	// everywhere (write-back). A dirty block is written back when it is evicted from a set
+	void Analyzer::access(Level & l, size_t st, uint32_t tag, bool rd, uint32_t h) {
+		(rd ? l.rd : l.wr)[std::min(h, maxAssoc + 1)]++;
+
+		uint32_t * t = &l.tag[st * maxAssoc];
+		uint32_t * hd = &l.hold[st * maxAssoc];
+		uint32_t * dt = &l.dirty[st * maxAssoc];
+		uint32_t n = l.n[st];
+		uint32_t cur = n;
+		for (uint32_t i = 0; i < n; i++) {
+			if (t[i] == tag) {
+				cur = i;
+				break;
+			}
+		}
+
+		if (rd) {
+			if (cur == n)
+				return;
+			uint32_t hc = hd[cur];
+			for (uint32_t i = cur; i > 0; i--) {
+				t[i] = t[i - 1];
+				hd[i] = hd[i - 1];
+				dt[i] = dt[i - 1];
+			}
+			t[0] = tag;
+			hd[0] = hc;
+			dt[0] = 0;
+			return;
+		}
+
+		// Sizes below the current holder miss: each full one evicts the least recent block it holds, which then
+		// lives on in the next size up, if at all
+		uint32_t upTo = std::min(cur == n ? inf : hd[cur], maxAssoc + 1);
+		std::fill(cnt.begin(), cnt.begin() + upTo, 0);
+		for (uint32_t i = 0; i < n; i++) {
+			for (uint32_t a = hd[i]; a < upTo; a++) {
+				if (++cnt[a] == a) {
+					hd[i] = a + 1;
+					if (a < dt[i])
+						l.wb[a]++;
+				}
+			}
+		}
+
+		// Drop the blocks evicted from every size and the written one, which goes on top
+		uint32_t m = 0;
+		for (uint32_t i = 0; i < n; i++) {
+			if (i == cur || hd[i] > maxAssoc)
+				continue;
+			t[m] = t[i];
+			hd[m] = hd[i];
+			dt[m] = dt[i];
+			m++;
+		}
+		for (uint32_t i = m; i > 0; i--) {
+			t[i] = t[i - 1];
+			hd[i] = hd[i - 1];
+			dt[i] = dt[i - 1];
+		}
+		t[0] = tag;
+		hd[0] = 1;
+		dt[0] = cfg.ev == cfg::EvictPlcy::writeThrough ? h : inf;
+		l.n[st] = m + 1;
+	}
+
+	void Analyzer::exec(const sass::Instr & inst) {
+		if (!inst.si)
+			return;
+		uint32_t slot = inst.wId % 32;
+		uint32_t lanes = reverseBits(static_cast<uint32_t>(inst.mask.to_ulong()));
+
+		// Lookups see the stacks before the instruction (Rfc::sync), so all holders are taken first
+		holds.clear();
+		for (int pass = 0; pass < 2; pass++) {
+			size_t n = 0;
+			for (const auto & oprd : inst.regPool()) {
+				if (oprd.type == reg::OprdT::addr)
+					continue;
+				bool rd = oprd.type == reg::OprdT::src;
+				uint32_t tag = oprd.index / cfg.nDW;
+
+				// Rfc::getCacheSet with nBlk / assoc = nSet
+				for (auto & l : levels) {
+					uint32_t set = 0;
+					if (rd)
+						set = oprd.pos % l.nSet;
+					else if (oprd.type == reg::OprdT::dst)
+						set = cfg.dMap == cfg::DestMap::ln ? tag * l.nSet / 256 : tag % l.nSet;
+					if (set >= l.nSet)
+						throw std::out_of_range("Runtime error: cache set out of range.\n");
+
+					for (auto m = lanes; m; m &= m - 1) {
+						size_t st = (slot * 32 + __builtin_ctz(m)) * l.nSet + set;
+						if (pass == 0)
+							holds.push_back(holdOf(l, st, tag));
+						else
+							access(l, st, tag, rd, holds[n++]);
+					}
+				}
+			}
+		}
+	}
+
+	std::vector<Point> Analyzer::results() {
+		std::vector<Point> points;
+		for (auto & l : levels) {
+			uint64_t nRd = 0, nWr = 0;
+			for (uint32_t d = 1; d <= maxAssoc + 1; d++) {
+				nRd += l.rd[d];
+				nWr += l.wr[d];
+			}
+
+			Point p{l.nSet, 0, 0, 0, 0, 0, 0, 0};
+			for (uint32_t a = 1; a <= maxAssoc; a++) {
+				p.assoc = a;
+				p.rdHit += l.rd[a];
+				p.wrHit += l.wr[a];
+				p.rdMiss = nRd - p.rdHit;
+				p.wrMiss = nWr - p.wrHit;
+				p.mrfRd = p.rdMiss;
+				p.mrfWr = l.wb[a] + (cfg.ev == cfg::EvictPlcy::writeThrough ? p.wrHit : 0);
+				points.push_back(p);
+			}
+		}
+		return points;
+	}
+
+	void run(const std::vector<std::string> & traceList, const std::shared_ptr<AsmParser> & asmParser, Analyzer & analyzer) {
+		for (auto & traceFile : traceList) {
+			auto traceParser = TraceReaderFactory::getInstance(traceFile, asmParser);
+			while (!traceParser->eof()) {
+				auto inst = traceParser->parse();
+				if (inst.opcode() == op::OP_VOID && traceParser->eof())
+					break;
+				analyzer.exec(inst);
+			}
+		}
+	}
+
+	void log(std::ofstream & of, const std::vector<Point> & points) {
+		for (const auto & p : points) {
+			uint64_t nRd = p.rdHit + p.rdMiss, nWr = p.wrHit + p.wrMiss;
+			of << "n_block=" << p.nSet * p.assoc << ",assoc=" << p.assoc << ";"
+			   << double(p.rdHit) / nRd * 100 << ";"
+			   << double(p.wrHit) / nWr * 100 << ";"
+			   << double(p.rdHit + p.wrHit) / (nRd + nWr) * 100 << ";"
+			   << double(int64_t(nRd) - int64_t(p.mrfRd)) / nRd * 100 << ";"
+			   << double(int64_t(nWr) - int64_t(p.mrfWr)) / nWr * 100 << ";"
+			   << p.mrfRd << ";" << p.mrfWr << "\n";
+		}
+	}
+
+};
@@ -64,6 +64,17 @@ namespace stat {
         rfcWrMissNum=0;
     }
 
+    void Stat::merge(const Stat & s) noexcept {
+        mrfRdNum+=s.mrfRdNum;
+        mrfWrNum+=s.mrfWrNum;
+        rfcRdNum+=s.rfcRdNum;
+        rfcWrNum+=s.rfcWrNum;
+        rfcRdHitNum+=s.rfcRdHitNum;
+        rfcRdMissNum+=s.rfcRdMissNum;
+        rfcWrHitNum+=s.rfcWrHitNum;
+        rfcWrMissNum+=s.rfcWrMissNum;
+    }
+
     float Stat::calcRfEngy() const {
         return (mrfRdNum * eMdl.eMrfRd) + 
                (mrfWrNum * eMdl.eMrfWr) + 
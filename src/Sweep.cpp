@@ -0,0 +1,152 @@
+#include "Sweep.h"
+
+#include <array>
+#include <algorithm>
+
+#include "Sim.h"
+#include "TraceReader.h"
+#include "ThreadPool.h"
+#include "Logger.h"
+#include "NextUse.h"
+
+namespace Sweep {
+
+	namespace {
+		const std::array<std::string, 6> topKeys = {"arch", "assoc", "n_block", "n_dw", "bitwidth", "window_len"};
+		const std::array<std::string, 4> plcyKeys = {"alloc", "repl", "evict", "dest_map"}; // order of the policy list
+
+		void setParam(YAML::Node & node, const std::string & key, const YAML::Node & val) {
+			if (std::find(topKeys.begin(), topKeys.end(), key) != topKeys.end()) {
+				node[key] = val;
+				return;
+			}
+			auto it = std::find(plcyKeys.begin(), plcyKeys.end(), key);
+			if (it == plcyKeys.end())
+				throw std::invalid_argument("Invalid input: unknown sweep parameter " + key + ".\n");
+			node["policy"][it - plcyKeys.begin()][key] = val;
+		}
+	};
+
+	std::vector<Point> expand(const std::string & baseFile, const std::string & gridFile) {
+		YAML::Node base, grid;
+		try {
+			base = YAML::LoadFile(baseFile);
+			grid = YAML::LoadFile(gridFile);
+		} catch (YAML::Exception & e) {
+			throw std::runtime_error("Runtime error: failed to open yaml file.");
+		}
+		if (!grid.IsMap())
+			throw std::invalid_argument("Invalid input: sweep grid must map parameters to value lists.\n");
+
+		std::vector<std::pair<std::string, std::vector<YAML::Node>>> axes;
+		for (auto kv : grid) {
+			std::vector<YAML::Node> vals;
+			if (kv.second.IsSequence()) {
+				for (auto v : kv.second)
+					vals.push_back(v);
+			} else {
+				vals.push_back(kv.second);
+			}
+			if (vals.empty())
+				throw std::invalid_argument("Invalid input: empty sweep parameter " + kv.first.as<std::string>() + ".\n");
+			axes.emplace_back(kv.first.as<std::string>(), std::move(vals));
+		}
+
+		std::vector<Point> points;
+		std::vector<size_t> idx(axes.size(), 0);
+		while (true) {
+			YAML::Node node = YAML::Clone(base);
+			Point p;
+			for (size_t i = 0; i < axes.size(); i++) {
+				const auto & val = axes[i].second[idx[i]];
+				setParam(node, axes[i].first, val);
+				p.params.emplace_back(axes[i].first, val.as<std::string>());
+			}
+			p.cfg = std::make_shared<cfg::GlobalCfg>();
+			cfg::CfgParser(node, p.cfg).parse();
+			points.push_back(std::move(p));
+
+			// next combination, last axis fastest
+			size_t i = axes.size();
+			while (i > 0 && ++idx[i - 1] == axes[i - 1].second.size())
+				idx[--i] = 0;
+			if (i == 0)
+				break;
+		}
+		return points;
+	}
+
+	bool needsNextUse(const std::vector<Point> & points) {
+		return std::any_of(points.begin(), points.end(), [](const Point & p) {
+			return p.cfg->repl == cfg::ReplPlcy::opt;
+		});
+	}
+
+	TraceSet::TraceSet(
+		const std::vector<std::string> & traceList,
+		const std::shared_ptr<AsmParser> & asmParser,
+		size_t nThreads,
+		bool annotate
+	) : kernels(traceList.size()), nextUse(traceList.size()) {
+		ThreadPool pool(std::min(nThreads, traceList.size()));
+		for (size_t k = 0; k < traceList.size(); k++) {
+			pool.submit([&, k](size_t) {
+				auto traceParser = TraceReaderFactory::getInstance(traceList[k], asmParser);
+				while (!traceParser->eof()) {
+					auto inst = traceParser->parse();
+					if (inst.opcode() == op::OP_VOID && traceParser->eof())
+						break;
+					kernels[k].push_back(inst);
+				}
+				if (annotate)
+					NextUse::annotate(kernels[k], nextUse[k]);
+			});
+		}
+		pool.wait();
+	}
+
+	void run(const std::vector<Point> & points, const TraceSet & traces, size_t nThreads, std::ofstream & of) {
+		const size_t nKernels = traces.kernels.size();
+
+		// (baseline, RFC) statistics per point and kernel
+		std::vector<std::vector<std::pair<stat::Stat, stat::Stat>>> stats(points.size());
+		for (size_t i = 0; i < points.size(); i++)
+			stats[i].assign(nKernels, {stat::Stat(points[i].cfg->eMdl), stat::Stat(points[i].cfg->eMdl)});
+
+		// Largest kernels first, so the stragglers are short tasks
+		std::vector<size_t> order(nKernels);
+		for (size_t k = 0; k < nKernels; k++)
+			order[k] = k;
+		std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+			return traces.kernels[a].size() > traces.kernels[b].size();
+		});
+
+		ThreadPool pool(nThreads);
+		for (auto k : order) {
+			for (size_t i = 0; i < points.size(); i++) {
+				pool.submit([&, i, k](size_t) {
+					Sim sim(points[i].cfg);
+					for (const auto & inst : traces.kernels[k])
+						sim.exec(inst);
+					sim.drainAll();
+					stats[i][k] = {*sim.scbBase, *sim.scb};
+				});
+			}
+		}
+		pool.wait();
+
+		for (size_t i = 0; i < points.size(); i++) {
+			stat::Stat base(points[i].cfg->eMdl), opt(points[i].cfg->eMdl);
+			for (auto & s : stats[i]) {
+				base.merge(s.first);
+				opt.merge(s.second);
+			}
+
+			for (size_t j = 0; j < points[i].params.size(); j++)
+				of << (j ? "," : "") << points[i].params[j].first << "=" << points[i].params[j].second;
+			of << ";";
+			Logger::logging(of, *points[i].cfg, base, opt);
+		}
+	}
+
+};
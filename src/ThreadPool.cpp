@@ -0,0 +1,108 @@
+#include "ThreadPool.h"
+
+namespace {
+    // Pool and worker index of the calling thread, if it is a pool worker
+    thread_local const ThreadPool * curPool = nullptr;
+    thread_local size_t curWorker = 0;
+};
+
+ThreadPool::ThreadPool(size_t n) : nQueued(0), nextQueue(0), nPending(0), stop(false) {
+    if (n == 0)
+        n = 1;
+    for (size_t i = 0; i < n; i++)
+        queues.push_back(std::make_unique<Queue>());
+    for (size_t i = 0; i < n; i++)
+        workers.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lk(mtx);
+        stop = true;
+    }
+    cvTask.notify_all();
+    for (auto & w : workers)
+        w.join();
+}
+
+size_t ThreadPool::size() const noexcept {
+    return workers.size();
+}
+
+size_t ThreadPool::defaultSize() noexcept {
+    auto n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+void ThreadPool::submit(Task task) {
+    size_t q = curPool == this ? curWorker : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        // Counted first so that nQueued never drops below the number of queued tasks
+        std::lock_guard<std::mutex> lk(mtx);
+        nQueued++;
+        nPending++;
+    }
+    {
+        std::lock_guard<std::mutex> lk(queues[q]->mtx);
+        queues[q]->tasks.push_back(std::move(task));
+    }
+    cvTask.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lk(mtx);
+    cvIdle.wait(lk, [this] { return nPending == 0; });
+    if (err) {
+        auto e = err;
+        err = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+// Own deque from the back, then the other deques from the front
+bool ThreadPool::pop(size_t id, Task & task) {
+    for (size_t i = 0; i < queues.size(); i++) {
+        auto & q = *queues[(id + i) % queues.size()];
+        std::lock_guard<std::mutex> lk(q.mtx);
+        if (q.tasks.empty())
+            continue;
+        if (i == 0) {
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        } else {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        }
+        nQueued--;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::run(size_t id) {
+    curPool = this;
+    curWorker = id;
+    while (true) {
+        Task task;
+        if (!pop(id, task)) {
+            std::unique_lock<std::mutex> lk(mtx);
+            cvTask.wait(lk, [this] { return stop || nQueued > 0; });
+            if (nQueued == 0)
+                return; // stopping
+            continue;
+        }
+
+        std::exception_ptr e;
+        try {
+            task(id);
+        } catch (...) {
+            e = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lk(mtx);
+        if (e && !err)
+            err = e;
+        if (--nPending == 0)
+            cvIdle.notify_all();
+    }
+}
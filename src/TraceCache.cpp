@@ -0,0 +1,190 @@
+#include "TraceCache.h"
+#include "BinTrace.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <cstring>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    constexpr char asmMagic[8] = {'R', 'F', 'C', 'A', 'S', 'M', 'C', '\0'};
+    constexpr uint32_t asmVersion = 1;
+
+    uint64_t fnv1a(uint64_t h, const void * p, size_t n) {
+        auto s = static_cast<const uint8_t *>(p);
+        for (size_t i = 0; i < n; i++) {
+            h ^= s[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    void putU32(std::string & buf, uint32_t v) {
+        buf.append(reinterpret_cast<const char *>(&v), sizeof(v));
+    }
+
+    void putStr(std::string & buf, const std::string & s) {
+        putU32(buf, static_cast<uint32_t>(s.size()));
+        buf.append(s);
+    }
+
+    // Bounds-checked reader over a loaded table file
+    struct Cursor {
+        const std::string & buf;
+        size_t pos;
+
+        bool u32(uint32_t & v) {
+            if (pos + sizeof(v) > buf.size())
+                return false;
+            std::memcpy(&v, buf.data() + pos, sizeof(v));
+            pos += sizeof(v);
+            return true;
+        }
+
+        bool bytes(size_t n, std::string & s) {
+            if (pos + n > buf.size())
+                return false;
+            s.assign(buf.data() + pos, n);
+            pos += n;
+            return true;
+        }
+
+        bool str(std::string & s) {
+            uint32_t n;
+            return u32(n) && bytes(n, s);
+        }
+    };
+
+}; // namespace
+
+TraceCache::TraceCache(const std::string & dir) : dir(dir) {
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec)
+        throw std::runtime_error("Runtime error: failed to create cache directory.\n");
+}
+
+// <dir>/<stem>-<hash of path, size, mtime and format version><ext>
+std::string TraceCache::entry(const std::string & file, const char * ext) const {
+    auto path = fs::absolute(file).lexically_normal().string();
+    uint64_t size = fs::file_size(file);
+    auto mtime = fs::last_write_time(file).time_since_epoch().count();
+    uint32_t ver = bt::version ^ (asmVersion << 16);
+
+    uint64_t h = 14695981039346656037ull;
+    h = fnv1a(h, path.data(), path.size() + 1);
+    h = fnv1a(h, &size, sizeof(size));
+    h = fnv1a(h, &mtime, sizeof(mtime));
+    h = fnv1a(h, &ver, sizeof(ver));
+
+    std::ostringstream os;
+    os << dir << "/" << fs::path(file).stem().string() << "-"
+       << std::hex << std::setw(16) << std::setfill('0') << h << ext;
+    return os.str();
+}
+
+// Publishes a finished temporary file; concurrent runs race harmlessly on rename
+void TraceCache::commit(const std::string & tmp, const std::string & dst) {
+    std::error_code ec;
+    fs::rename(tmp, dst, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        throw std::runtime_error("Runtime error: failed to write cache entry.\n");
+    }
+}
+
+std::string TraceCache::trace(const std::string & traceFile) {
+    if (bt::isBinTrace(traceFile))
+        return traceFile;
+
+    auto dst = entry(traceFile, ".rbt");
+    if (fs::exists(dst))
+        return dst;
+
+    std::ostringstream tmp;
+    tmp << dst << ".tmp." << getpid() << "." << std::hash<std::thread::id>()(std::this_thread::get_id());
+    try {
+        BinTraceWriter::convert(traceFile, tmp.str());
+    } catch (...) {
+        std::error_code ec;
+        fs::remove(tmp.str(), ec);
+        throw;
+    }
+    commit(tmp.str(), dst);
+    return dst;
+}
+
+bool TraceCache::loadAsm(const std::string & asmFile, AsmParser & asmParser) const {
+    if (!fs::exists(asmFile))
+        return false;
+
+    std::ifstream ifs(entry(asmFile, ".rasm"), std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+    std::string buf((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+
+    Cursor c{buf, 0};
+    std::string s;
+    uint32_t ver, nTab, nMap;
+    if (!c.bytes(sizeof(asmMagic), s) || std::memcmp(s.data(), asmMagic, sizeof(asmMagic)) != 0 ||
+        !c.u32(ver) || ver != asmVersion || !c.u32(nTab))
+        return false;
+
+    std::vector<ReuseTab> tab(nTab);
+    for (auto & t : tab) {
+        uint32_t shift;
+        if (!c.u32(shift) || !c.str(s))
+            return false;
+        t.shift = shift;
+        t.nib.assign(s.begin(), s.end());
+    }
+
+    std::unordered_map<std::string, size_t> map;
+    if (!c.u32(nMap))
+        return false;
+    for (uint32_t i = 0; i < nMap; i++) {
+        uint32_t idx;
+        if (!c.str(s) || !c.u32(idx) || idx >= nTab)
+            return false;
+        map.emplace(s, idx);
+    }
+
+    *asmParser.tab = std::move(tab);
+    *asmParser.map = std::move(map);
+    return true;
+}
+
+void TraceCache::saveAsm(const std::string & asmFile, const AsmParser & asmParser) const {
+    if (!fs::exists(asmFile))
+        return;
+
+    std::string buf(asmMagic, sizeof(asmMagic));
+    putU32(buf, asmVersion);
+    putU32(buf, static_cast<uint32_t>(asmParser.tab->size()));
+    for (const auto & t : *asmParser.tab) {
+        putU32(buf, t.shift);
+        putStr(buf, std::string(t.nib.begin(), t.nib.end()));
+    }
+    putU32(buf, static_cast<uint32_t>(asmParser.map->size()));
+    for (const auto & kv : *asmParser.map) {
+        putStr(buf, kv.first);
+        putU32(buf, static_cast<uint32_t>(kv.second));
+    }
+
+    auto dst = entry(asmFile, ".rasm");
+    std::ostringstream tmp;
+    tmp << dst << ".tmp." << getpid();
+    {
+        std::ofstream ofs(tmp.str(), std::ios::binary | std::ios::trunc);
+        ofs.write(buf.data(), buf.size());
+        if (!ofs)
+            throw std::runtime_error("Runtime error: failed to write cache entry.\n");
+    }
+    commit(tmp.str(), dst);
+}
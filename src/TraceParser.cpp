@@ -1,42 +1,179 @@
 #include "TraceParser.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
 TraceParser::TraceParser(
     const std::string & traceFile,
-    const std::shared_ptr<std::vector<mapT>> & reuseInfo,
-    const std::shared_ptr<std::unordered_map<std::string, size_t>>& map 
-) : reuseInfo(reuseInfo), map(map) {
-    traceIfs.open(traceFile);
-    if (!traceIfs.is_open()) {
+    const std::shared_ptr<AsmParser> & asmParser
+) : traceFd(-1), buf(blkSize), bufOff(0), lineBeg(0), dataEnd(0), srcEof(true), asmParser(asmParser), reuseTab(nullptr), kernelOff(TraceMark::noKernel),
+    blockId(0, 0, 0), wId(0) {
+    if (asmParser)
+        sTab = asmParser->sTab;
+    else
+        sTab = std::make_shared<StaticInstrTab>(); // private table, valid while the parser lives
+    open(traceFile);
+}
+
+TraceParser::~TraceParser() {
+    close();
+}
+
+void TraceParser::open(const std::string & traceFile) {
+    this->traceFile = traceFile;
+    siCache.clear();
+    traceFd = ::open(traceFile.c_str(), O_RDONLY);
+    if (traceFd < 0) {
         throw std::runtime_error("Runtime error: failed to open trace file.\n");
     }
+    posix_fadvise(traceFd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    // Compressed traces are inflated on a separate thread
+    auto fmt = InflateStream::detect(traceFile);
+    if (fmt != InflateStream::Fmt::none) {
+        ::close(traceFd);
+        traceFd = -1;
+        inflate = std::make_unique<InflateStream>(traceFile, fmt);
+    }
+    bufOff = 0;
+    lineBeg = 0;
+    dataEnd = 0;
+    srcEof = false;
+    kernelOff = TraceMark::noKernel;
+}
+
+void TraceParser::close() noexcept {
+    if (traceFd >= 0)
+        ::close(traceFd);
+    traceFd = -1;
+    inflate.reset();
+    srcEof = true;
 }
 
 bool TraceParser::eof() const {
-    return traceIfs.eof();
+    return srcEof && lineBeg >= dataEnd;
 }
 
 void TraceParser::reset(const std::string & s) {
-    traceIfs = std::ifstream(s);
+    close();
+    open(s);
 }
 
-bool TraceParser::isOprd(const std::string & tok) const {
-    if (tok.size() < 2 || tok[0] != 'R') 
+const KernelInfo & TraceParser::info() const noexcept {
+    return kernelInfo;
+}
+
+// Moves the unread tail to the front of the buffer and reads the next block
+bool TraceParser::fill() {
+    if (srcEof)
         return false;
-        
-    try {
-        std::stoi(tok.substr(1));
-        return true;
-    } catch (const std::exception & e) {
-        std::cerr << e.what() << std::endl;
+
+    size_t tail = dataEnd - lineBeg;
+    if (lineBeg > 0 && tail > 0)
+        std::memmove(buf.data(), buf.data() + lineBeg, tail);
+    bufOff += lineBeg;
+    lineBeg = 0;
+    dataEnd = tail;
+
+    // A single line longer than the buffer
+    if (buf.size() - dataEnd < blkSize / 2)
+        buf.resize(buf.size() * 2);
+
+    ssize_t n;
+    if (inflate)
+        n = inflate->read(buf.data() + dataEnd, buf.size() - dataEnd);
+    else {
+        do {
+            n = ::read(traceFd, buf.data() + dataEnd, buf.size() - dataEnd);
+        } while (n < 0 && errno == EINTR);
+    }
+
+    if (n < 0)
+        throw std::runtime_error("Runtime error: failed to read trace file.\n");
+    if (n == 0) {
+        srcEof = true;
+        return false;
+    }
+    dataEnd += n;
+    return true;
+}
+
+// Next line without its '\n'; the view stays valid until the next call
+bool TraceParser::nextLine(std::string_view & line) {
+    while (true) {
+        const char * beg = buf.data() + lineBeg;
+        const char * nl = static_cast<const char *>(std::memchr(beg, '\n', dataEnd - lineBeg));
+        if (nl) {
+            line = std::string_view(beg, nl - beg);
+            lineBeg += (nl - beg) + 1;
+            return true;
+        }
+        if (!fill()) {
+            // Last line without a trailing newline
+            if (lineBeg >= dataEnd)
+                return false;
+            line = std::string_view(buf.data() + lineBeg, dataEnd - lineBeg);
+            lineBeg = dataEnd;
+            return true;
+        }
+    }
+}
+
+// Next line to read at file offset off; compressed streams only move forward, so they are reopened to go back
+void TraceParser::moveTo(uint64_t off) {
+    if (off >= bufOff && off <= bufOff + dataEnd) {
+        lineBeg = off - bufOff;
+        return;
+    }
+    if (!inflate) {
+        if (lseek(traceFd, static_cast<off_t>(off), SEEK_SET) < 0)
+            throw std::runtime_error("Runtime error: failed to seek trace file.\n");
+        bufOff = off;
+        lineBeg = 0;
+        dataEnd = 0;
+        srcEof = false;
+        return;
+    }
+    if (off < bufOff + lineBeg)
+        reset(traceFile);
+    while (bufOff + dataEnd < off) {
+        lineBeg = dataEnd;
+        if (!fill())
+            throw std::runtime_error("Runtime error: trace mark past the end of the file.\n");
     }
-    return false;
+    lineBeg = off - bufOff;
 }
 
-bool TraceParser::IsAddrOprd(const std::string & tok) const {
+// Splits on single spaces like std::getline(ss, tok, ' ')
+void TraceParser::tokenize(std::string_view line) {
+    toks.clear();
+    size_t start = 0;
+    while (start < line.size()) {
+        size_t pos = line.find(' ', start);
+        if (pos == std::string_view::npos) {
+            toks.push_back(line.substr(start));
+            break;
+        }
+        toks.push_back(line.substr(start, pos - start));
+        start = pos + 1;
+    }
+}
+
+bool TraceParser::isOprd(std::string_view tok) const noexcept {
+    if (tok.size() < 2 || tok[0] != 'R') 
+        return false;
+    int index;
+    return util::parseInt(tok.substr(1), index);
+}
+
+bool TraceParser::IsAddrOprd(std::string_view tok) const noexcept {
     return (tok.size() > 3 && tok.substr(0, 2) == "0x"); 
 }
 
-reg::Oprd TraceParser::parseReg(const std::string & tok, reg::OprdT type, uint32_t pos) const {
+reg::Oprd TraceParser::parseReg(std::string_view tok, reg::OprdT type, uint32_t pos) const {
     if(tok.size() < 2) 
         throw std::invalid_argument("Invalid input: tok.size() < 2.\n");
     if(tok[0] != 'R' && type != reg::OprdT::addr) 
@@ -45,12 +182,10 @@ reg::Oprd TraceParser::parseReg(const std::string & tok, reg::OprdT type, uint32
     if(type == reg::OprdT::addr) 
         return reg::Oprd(reg::OprdT::addr, pos, pos);
 
-    uint32_t index; 
-    try {
-        index = std::stoi(tok.substr(1));
-    } catch (const std::invalid_argument & e) {
+    int indexSigned;
+    if (!util::parseInt(tok.substr(1), indexSigned))
         throw std::invalid_argument("Invalid input: register index.");
-    }
+    uint32_t index = static_cast<uint32_t>(indexSigned);
 
     uint32_t set;
     if (type == reg::OprdT::dst)
@@ -62,25 +197,22 @@ reg::Oprd TraceParser::parseReg(const std::string & tok, reg::OprdT type, uint32
     return reg;
 }
 
-bool TraceParser::isInst(const std::vector<std::string> & toks) const {
+bool TraceParser::isInst(const std::vector<std::string_view> & toks) const noexcept {
     if(toks.size() < 4) 
         return false;
-    std::string strPC(toks[0]);
+    auto strPC = toks[0];
     if(strPC.length() != 4) 
         return false;
     for(auto c : strPC) {
-        if (!std::isxdigit(c)) 
+        if (!std::isxdigit(static_cast<unsigned char>(c))) 
             return false;
     } 
     return true;
 }
 
-op::Opcode TraceParser::parseOpcode(const std::string & tok) const noexcept {
+op::Opcode TraceParser::parseOpcode(std::string_view tok) const noexcept {
     size_t dotIndex = tok.find('.');
-    if (dotIndex != std::string::npos)
-        return op::str2op(tok.substr(0, dotIndex));
-    else 
-        return op::str2op(tok);
+    return op::str2op(tok.substr(0, dotIndex));
 }
 
 void TraceParser::extendHmmaRegs(std::vector<reg::Oprd> & oprds) const {
@@ -130,39 +262,24 @@ void TraceParser::extendImmaRegs(std::vector<reg::Oprd> & oprds) const {
     oprds.push_back(reg::Oprd(reg::OprdT::dst, matD.index + 1, 3, 1));
 }
 
-sass::Instr TraceParser::parseInst(const std::vector<std::string>& toks) {
-    if (toks.size() < 6) 
-        throw std::invalid_argument("Invalid input: toks.size()<6.\n");
-
-    uint32_t pc;
-    auto & pcStr = toks.at(0);
-    std::stringstream pcStrStream(pcStr);
-    pcStrStream >> std::hex >> pc;
-
-    std::bitset<32> mask;
-    auto & maskStr = toks.at(1);
-    std::stringstream maskStrStream(maskStr);
-    unsigned long mask_ui;
-    maskStrStream >> std::hex >> mask_ui;
-    mask = std::bitset<32> (mask_ui);
-
+// Decodes the static part of an instruction line
+sass::StaticInstr TraceParser::decodeInst(const std::vector<std::string_view>& toks, uint32_t pc) const {
     op::Opcode opcode;
     std::bitset<4> flags = static_cast<std::bitset<4>>("0000");  
 
-    auto tabIt = map->find(kernelInfo.kernelSym);
-    auto tab = reuseInfo->at(tabIt->second);
-    auto it = tab.find(pc);
-    if (it != tab.end())
-        flags = it->second;
+    // Reuse tables are optional (e.g., when converting traces)
+    if (reuseTab)
+        flags = reuseTab->get(pc);
 
     std::vector<reg::Oprd> regs;
+    regs.reserve(toks.size());
 
     if (toks[2] == "1") {
         opcode = this->parseOpcode(toks.at(4));
 
         uint32_t curPos = 0;
         for (auto i = 5; i < toks.size(); i++) {
-            auto & s = toks.at(i);
+            auto s = toks[i];
             if (isOprd(s)) {
                 regs.push_back(parseReg(s, reg::OprdT::src, curPos));
                 curPos++;
@@ -173,15 +290,15 @@ sass::Instr TraceParser::parseInst(const std::vector<std::string>& toks) {
             }
         }
         regs.push_back(parseReg(toks.at(3), reg::OprdT::dst, 0));
-        if (opcode == op::OP_HMMA) extendHmmaRegs(regs);
-        if (opcode == op::OP_IMMA) extendImmaRegs(regs);
-        return sass::Instr(pc, mask, blockId, wId, opcode, regs, flags);
+        auto expand = op::opTab[opcode].expand;
+        if (expand == op::Expand::hmma) extendHmmaRegs(regs);
+        if (expand == op::Expand::imma) extendImmaRegs(regs);
     }
-    else if (toks.at(2) == "0") {
+    else {
         opcode = this->parseOpcode(toks.at(3));
         uint32_t curPos = 0;
         for (auto i = 5; i < toks.size(); i++) {
-            auto & s = toks.at(i);
+            auto s = toks[i];
             if (isOprd(s)) {
                 regs.push_back(parseReg(s, reg::OprdT::src, curPos));
                 curPos++;
@@ -191,60 +308,130 @@ sass::Instr TraceParser::parseInst(const std::vector<std::string>& toks) {
                 curPos++;
             }
         }
-        return sass::Instr(pc, mask, blockId, wId, opcode, regs, flags);
     }
-    else 
+    return sass::StaticInstr{pc, opcode, std::move(regs), flags};
+}
+
+sass::Instr TraceParser::parseInst(const std::vector<std::string_view>& toks) {
+    if (toks.size() < 6) 
+        throw std::invalid_argument("Invalid input: toks.size()<6.\n");
+
+    uint64_t pcVal = 0;
+    util::parseHex(toks.at(0), pcVal);
+    uint32_t pc = static_cast<uint32_t>(pcVal);
+
+    uint64_t mask_ui = 0;
+    util::parseHex(toks.at(1), mask_ui);
+    std::bitset<32> mask(mask_ui);
+
+    if (toks[2] != "1" && toks[2] != "0")
         return sass::Instr(); 
+
+    // Static key: everything after the mask, with memory addresses reduced to a marker
+    // (decoding depends only on their count and position)
+    siKey.clear();
+    for (size_t i = 2; i < toks.size(); i++) {
+        if (i >= 5 && IsAddrOprd(toks[i]))
+            siKey.push_back('\x01');
+        else
+            siKey.append(toks[i]);
+        siKey.push_back(' ');
+    }
+
+    auto & cands = siCache[pc];
+    for (const auto & c : cands) {
+        if (c.first == siKey)
+            return sass::Instr(c.second, mask, blockId, wId);
+    }
+
+    auto si = sTab->intern(kernelInfo.kernelSym, pc, siKey, [&] { return decodeInst(toks, pc); });
+    cands.emplace_back(siKey, si);
+    return sass::Instr(si, mask, blockId, wId);
 }
 
+void TraceParser::enterKernel(std::string_view sym) {
+    kernelInfo.kernelSym = sym;
+    siCache.clear();
+    reuseTab = nullptr;
+    if (asmParser) {
+        reuseTab = asmParser->find(kernelInfo.kernelSym);
+        if (!reuseTab)
+            throw std::runtime_error("Runtime error: kernel name error.\n");
+    }
+}
 
+// Header lines update the parser state; the first instruction line is returned
 sass::Instr TraceParser::parse() {
-    if (eof()) return sass::Instr();
-
-    std::string instStr;
-    std::getline(traceIfs, instStr);
-
-    std::stringstream ss(instStr);
-	std::string tokStr;
-	std::vector<std::string> tokStrs;
-    while(std::getline(ss, tokStr, ' ')) {
-		tokStrs.push_back(tokStr);
-	}
-
-    if (tokStrs.empty())
-        return this->parse();
-    else if(tokStrs.at(0) == "-kernel" && tokStrs.at(1) == "name") {
-        kernelInfo.kernelSym = tokStrs.at(3);
-        if (map->find(kernelInfo.kernelSym) == map->end())
-            throw std::runtime_error("Runtime error: kernel name error.\n");
-        return parse();
-    }
-    else if(tokStrs.at(0) == "thread" && tokStrs.at(1) == "block" && tokStrs.size() == 4) {
-        int tbX, tbY, tbZ;
-        size_t posY = tokStrs.at(3).find(',', 0);
-        size_t posZ = tokStrs.at(3).find(',', posY + 1);
-            
-        tbX = std::stoi(tokStrs.at(3).substr(0, posY));
-        tbY = std::stoi(tokStrs.at(3).substr(posY + 1, posZ - posY - 1));
-        tbZ = std::stoi(tokStrs.at(3).substr(posZ + 1, tokStrs[3].size() - posZ - 1));
-        
-        blockId.x = tbX;
-        blockId.y = tbY;
-        blockId.z = tbZ; 
-       
-        return parse();
-    }
-    else if(tokStrs.at(0) == "warp" && tokStrs.size() == 3) {
-        int wIdSigned;
-        wIdSigned = std::stoi(tokStrs.at(2));
-        if(wIdSigned < 0) 
-            throw std::runtime_error("Runtime error: negative warp ID.\n");
-        wId = static_cast<unsigned>(wIdSigned);
-        return parse();
-    }
-    else if (isInst(tokStrs)) {
-        return parseInst(tokStrs);
-    }    
-    else 
-        return parse();
+    std::string_view line;
+    uint64_t at = bufOff + lineBeg; // offset of the line
+    for (; nextLine(line); at = bufOff + lineBeg) {
+        tokenize(line);
+
+        if (toks.empty())
+            continue;
+        else if(toks.at(0) == "-kernel" && toks.at(1) == "name") {
+            kernelOff = at;
+            enterKernel(toks.at(3));
+        }
+        else if(toks.at(0) == "thread" && toks.at(1) == "block" && toks.size() == 4) {
+            auto tb = toks.at(3);
+            size_t posY = tb.find(',', 0);
+            size_t posZ = tb.find(',', posY + 1);
+            if (posY == std::string_view::npos || posZ == std::string_view::npos)
+                throw std::invalid_argument("Invalid input: thread block index.\n");
+
+            int tbX, tbY, tbZ;
+            if (!util::parseInt(tb.substr(0, posY), tbX) ||
+                !util::parseInt(tb.substr(posY + 1, posZ - posY - 1), tbY) ||
+                !util::parseInt(tb.substr(posZ + 1), tbZ))
+                throw std::invalid_argument("Invalid input: thread block index.\n");
+
+            blockId.x = tbX;
+            blockId.y = tbY;
+            blockId.z = tbZ; 
+        }
+        else if(toks.at(0) == "warp" && toks.size() == 3) {
+            int wIdSigned;
+            if (!util::parseInt(toks.at(2), wIdSigned))
+                throw std::invalid_argument("Invalid input: warp ID.\n");
+            if(wIdSigned < 0) 
+                throw std::runtime_error("Runtime error: negative warp ID.\n");
+            wId = static_cast<unsigned>(wIdSigned);
+        }
+        else if (isInst(toks)) {
+            return parseInst(toks);
+        }
+    }
+    return sass::Instr();
+}
+
+TraceMark TraceParser::mark() const {
+    TraceMark m;
+    m.off = bufOff + lineBeg;
+    m.kernelOff = kernelOff;
+    m.blockId = blockId;
+    m.wId = wId;
+    return m;
+}
+
+// The kernel header line is read again, then the CTA and warp state restored
+void TraceParser::seek(const TraceMark & m) {
+    if (m.kernelOff == TraceMark::noKernel) {
+        reset(traceFile);
+    }
+    else {
+        moveTo(m.kernelOff);
+        std::string_view line;
+        if (!nextLine(line))
+            throw std::runtime_error("Runtime error: trace mark past the end of the file.\n");
+        tokenize(line);
+        if (toks.size() < 4 || toks[0] != "-kernel" || toks[1] != "name")
+            throw std::runtime_error("Runtime error: trace mark does not match the file.\n");
+        kernelOff = m.kernelOff;
+        enterKernel(toks[3]);
+    }
+
+    moveTo(m.off);
+    blockId = m.blockId;
+    wId = m.wId;
 }
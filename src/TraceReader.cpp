@@ -0,0 +1,12 @@
+#include "TraceReader.h"
+#include "TraceParser.h"
+#include "BinTrace.h"
+
+std::unique_ptr<BaseTraceReader> TraceReaderFactory::getInstance(
+    const std::string & traceFile,
+    const std::shared_ptr<AsmParser> & asmParser
+) {
+    if (bt::isBinTrace(traceFile))
+        return std::make_unique<BinTraceReader>(traceFile, asmParser);
+    return std::make_unique<TraceParser>(traceFile, asmParser);
+}
@@ -11,20 +11,230 @@
 #include <vector>
 #include <stdexcept>
 #include <memory>
+#include <filesystem>
+#include <sstream>
+#include <algorithm>
 
 #include "TraceParser.h"
-#include "Rfc.h"
+#include "BinTrace.h"
+#include "Sim.h"
+#include "ThreadPool.h"
+#include "TraceCache.h"
+#include "Sweep.h"
+#include "StackDist.h"
+#include "Sampling.h"
+#include "Checkpoint.h"
 #include "Logger.h"
 
 #define NDEBUG
 
+// Resolves a kernelslist.g entry, falling back to its gzip/xz compressed variants
+static std::string resolveTrace(const std::string & traceDir, const std::string & name) {
+	const std::string path = traceDir + "/" + name;
+	if (std::filesystem::exists(path))
+		return path;
+	for (auto ext : {".gz", ".xz"}) {
+		if (std::filesystem::exists(path + ext))
+			return path + ext;
+	}
+	return path;
+}
+
+// Converts every kernel of an NVBit trace directory to the binary trace format
+static int convertTraces(int argc, char ** argv) {
+	if(argc < 6 || std::string(argv[2]) != "-t" || std::string(argv[4]) != "-o") {
+		std::cerr << "Usage: " << argv[0] << " convert -t <path_to_trace_dir> "
+				  << "-o <path_to_output_dir>\n";
+		return 1;
+	}
+
+	const std::string traceDir = std::string(argv[3]);
+	const std::string outDir = std::string(argv[5]);
+
+	std::ifstream traceListIf(traceDir + "/kernelslist.g");
+	if(!traceListIf.is_open()) {
+		std::cerr << "[RFC-sim] Failed to open " << traceDir << "/kernelslist.g" << std::endl;
+		return 1;
+	}
+	std::filesystem::create_directories(outDir);
+	std::ofstream traceListOf(outDir + "/kernelslist.g");
+
+	std::string s;
+	while(std::getline(traceListIf, s)) {
+		if(s.substr(0, 6) != "kernel") {
+			traceListOf << s << "\n";
+			continue;
+		}
+		std::string binName = std::filesystem::path(s).stem().string() + ".rbt";
+		auto n = BinTraceWriter::convert(resolveTrace(traceDir, s), outDir + "/" + binName);
+		std::cout << "[RFC-sim] " << s << " -> " << binName << " (" << n << " instructions)" << std::endl;
+		traceListOf << binName << "\n";
+	}
+	return 0;
+}
+
+// Kernel names of kernelslist.g, resolved against the trace directory
+static std::vector<std::string> readTraceList(const std::string & traceDir) {
+	std::ifstream traceListIf(traceDir + "/kernelslist.g");
+	std::string s;
+	std::vector<std::string> traceList;
+	while(std::getline(traceListIf, s)) {
+		if(s.substr(0, 6) == "kernel")
+			traceList.push_back(resolveTrace(traceDir, s));
+	}
+	return traceList;
+}
+
+// Reuse tables of the assembly file; with a cache directory, traces are redirected to their binary copies
+static std::shared_ptr<AsmParser> openInputs(
+	const std::string & asmFile,
+	const std::string & cacheDir,
+	std::vector<std::string> & traceList
+) {
+	std::shared_ptr<AsmParser> asmParser = std::make_shared<AsmParser>(
+		asmFile, 
+		std::make_shared<std::vector<ReuseTab>>(),
+		std::make_shared<std::unordered_map<std::string, size_t>>()
+	);
+	std::unique_ptr<TraceCache> cache;
+	if (!cacheDir.empty())
+		cache = std::make_unique<TraceCache>(cacheDir);
+
+	// Without a cache only the function offsets are indexed (in the background); each kernel's reuse flags
+	// are decoded when a trace first names it
+	if (!cache)
+		asmParser->indexAsync();
+	else if (!cache->loadAsm(asmFile, *asmParser)) {
+		asmParser->parse();
+		cache->saveAsm(asmFile, *asmParser);
+	}
+
+	// Decoded traces are converted once and memory-mapped afterwards
+	if (cache) {
+		for (auto & traceFile : traceList)
+			traceFile = cache->trace(traceFile);
+	}
+	return asmParser;
+}
+
+// Simulates every point of a parameter grid over one decoded copy of the traces
+static int sweepConfigs(int argc, char ** argv) {
+	if(argc < 12 || std::string(argv[2]) != "-t" || std::string(argv[4]) != "-c" || std::string(argv[6]) != "-g"
+		|| std::string(argv[8]) != "-d" || std::string(argv[10]) != "-o") {
+		std::cerr << "Usage: " << argv[0] << " sweep -t <path_to_trace_dir> -c <path_to_base_config> "
+				  << "-g <path_to_grid_file> -d <path_to_asm_file> -o <path_to_log_file> "
+				  << "[-j <# of threads>] [-C <path_to_cache_dir>]\n";
+		return 1;
+	}
+
+	const std::string traceDir = std::string(argv[3]);
+	const std::string asmFile = std::string(argv[9]);
+	size_t nThreads = ThreadPool::defaultSize();
+	std::string cacheDir;
+	for (auto i = 12; i < argc; i++) {
+		const std::string opt = std::string(argv[i]);
+		if (opt == "-j" && i + 1 < argc)
+			nThreads = std::max(1, std::stoi(argv[++i]));
+		else if (opt == "-C" && i + 1 < argc)
+			cacheDir = argv[++i];
+	}
+
+	auto traceList = readTraceList(traceDir);
+	if(traceList.empty()) {
+		std::cerr << "[RFC-sim] Empty kernel list." << std::endl;
+		return 1;
+	}
+	auto points = Sweep::expand(argv[5], argv[7]);
+	std::cout << "[RFC-sim] Sweep: " << points.size() << " configs x " << traceList.size() << " kernels" << std::endl;
+
+	auto asmParser = openInputs(asmFile, cacheDir, traceList);
+
+	Sweep::TraceSet traces(traceList, asmParser, nThreads, Sweep::needsNextUse(points));
+	std::ofstream of(argv[11], std::ios::app);
+	if (!of.is_open()) {
+		std::cerr << "[RFC-sim] Failed to open " << argv[11] << std::endl;
+		return 1;
+	}
+	Sweep::run(points, traces, nThreads, of);
+	std::cout << "[RFC-sim] End.\n\n";
+	return 0;
+}
+
+// Hit rates of every (# of sets, associativity) of an LRU write-allocate RFC from one pass over the traces
+static int stackDist(int argc, char ** argv) {
+	if(argc < 10 || std::string(argv[2]) != "-t" || std::string(argv[4]) != "-c" || std::string(argv[6]) != "-d"
+		|| std::string(argv[8]) != "-o") {
+		std::cerr << "Usage: " << argv[0] << " stack -t <path_to_trace_dir> -c <path_to_config_file> "
+				  << "-d <path_to_asm_file> -o <path_to_log_file> [-s <max # of sets>] [-a <max associativity>] "
+				  << "[-C <path_to_cache_dir>]\n";
+		return 1;
+	}
+
+	const std::string traceDir = std::string(argv[3]);
+	const std::string asmFile = std::string(argv[7]);
+	uint32_t maxSet = 16;
+	uint32_t maxAssoc = 16;
+	std::string cacheDir;
+	for (auto i = 10; i < argc; i++) {
+		const std::string opt = std::string(argv[i]);
+		if (opt == "-s" && i + 1 < argc)
+			maxSet = std::max(1, std::stoi(argv[++i]));
+		else if (opt == "-a" && i + 1 < argc)
+			maxAssoc = std::max(1, std::stoi(argv[++i]));
+		else if (opt == "-C" && i + 1 < argc)
+			cacheDir = argv[++i];
+	}
+
+	auto traceList = readTraceList(traceDir);
+	if(traceList.empty()) {
+		std::cerr << "[RFC-sim] Empty kernel list." << std::endl;
+		return 1;
+	}
+	std::shared_ptr<cfg::GlobalCfg> cfg = std::make_shared<cfg::GlobalCfg>();
+	cfg::CfgParser(argv[5], cfg).parse();
+	std::cout << "[RFC-sim] Stack distances: LRU write-allocate, n_dw " << cfg->nDW << ", " << cfg->ev
+			  << "; the geometry and allocation/replacement policies of the config are ignored" << std::endl;
+
+	auto asmParser = openInputs(asmFile, cacheDir, traceList);
+	StackDist::Analyzer analyzer(*cfg, maxSet, maxAssoc);
+	StackDist::run(traceList, asmParser, analyzer);
+
+	std::ofstream of(argv[9], std::ios::app);
+	if (!of.is_open()) {
+		std::cerr << "[RFC-sim] Failed to open " << argv[9] << std::endl;
+		return 1;
+	}
+	StackDist::log(of, analyzer.results());
+	std::cout << "[RFC-sim] End.\n\n";
+	return 0;
+}
+
 int main(int argc, char ** argv) {
+
+	if(argc > 1 && std::string(argv[1]) == "convert")
+		return convertTraces(argc, argv);
+	if(argc > 1 && std::string(argv[1]) == "sweep")
+		return sweepConfigs(argc, argv);
+	if(argc > 1 && std::string(argv[1]) == "stack")
+		return stackDist(argc, argv);
     
 	if(argc < 7 || std::string(argv[1]) != "-t" || std::string(argv[3]) != "-c" || std::string(argv[5]) != "-d") {
         std::cerr << "Usage: " << argv[0] << " -t <path_to_trace_dir> " 
                   << "-c <path_to_config_file> " 
 				  << "-d <path_to_asm_file>" 
-				  << "-o <path_to_log_file>\n";
+				  << "-o <path_to_log_file> "
+				  << "[-p | -k | -w | -l] [-j <# of threads>] [-C <path_to_cache_dir>] "
+				  << "[-S <fraction> [-U <interval length>] [-R] [-e <margin>] | -P <simpoint file> [-I <interval length>]] "
+				  << "[-W <warming length>] "
+				  << "[--checkpoint <file> [--every <# of instructions>] [--prefix <# of instructions>]] "
+				  << "[--resume <file> | --fork <file>]\n";
+		std::cerr << "       " << argv[0] << " convert -t <path_to_trace_dir> -o <path_to_output_dir>\n";
+		std::cerr << "       " << argv[0] << " sweep -t <path_to_trace_dir> -c <path_to_base_config> "
+				  << "-g <path_to_grid_file> -d <path_to_asm_file> -o <path_to_log_file> "
+				  << "[-j <# of threads>] [-C <path_to_cache_dir>]\n";
+		std::cerr << "       " << argv[0] << " stack -t <path_to_trace_dir> -c <path_to_config_file> "
+				  << "-d <path_to_asm_file> -o <path_to_log_file> [-s <max # of sets>] [-a <max associativity>] "
+				  << "[-C <path_to_cache_dir>]\n";
         return 1;
     }
    
@@ -34,19 +244,110 @@ int main(int argc, char ** argv) {
 	const std::string logFile = std::string(argv[8]);
 	const std::string traceListFile = traceDir + "/kernelslist.g";
 
+	// -c takes a comma-separated list of configs, all simulated from a single pass over the trace
+	std::vector<std::string> cfgList;
+	std::stringstream cfgSs(cfgFile);
+	for (std::string f; std::getline(cfgSs, f, ',');) {
+		if (!f.empty())
+			cfgList.push_back(f);
+	}
+
+	// -p: parse and simulate on separate threads
+	// -k: flush the RFC at kernel boundaries and simulate kernels concurrently (-j <# of threads>)
+	// -w: simulate the warp slots of each config concurrently (-j <# of threads>)
+	// -l: split every warp slot into (cache set, lane group) substreams simulated on a thread pool (-j <# of threads>)
+	// -C: reuse decoded traces and reuse tables from a cache directory
+	// -S: measure this fraction of the trace in detail and estimate the rest (see Sampling); -U: instructions per
+	//     measured interval, -W: warming instructions per warp slot, -R: sample random CTAs instead of intervals,
+	//     -e: target confidence half-width of the hit rates (percentage points)
+	// -P: only simulate the representative intervals of the SimPoint phases in a file, profiling the trace into it
+	//     first if it does not exist; -I: interval length when profiling
+	// --checkpoint: save the simulator state to a file every --every instructions and at the end, or only after the
+	//     first --prefix instructions, where the run stops; --resume: continue a run from its checkpoint;
+	//     --fork: start from a (warm-up) checkpoint of other configs with the same geometry, counters cleared
+	bool pipelined = false;
+	bool kernelParallel = false;
+	bool slotParallel = false;
+	bool laneSet = false;
+	size_t nThreads = ThreadPool::defaultSize();
+	std::string cacheDir;
+	bool sampled = false;
+	Sampling::Plan plan;
+	std::string simPointFile;
+	SimPoint::Options simPointOpt;
+	Checkpoint::Plan ckpt;
+	for (auto i = 9; i < argc; i++) {
+		const std::string opt = std::string(argv[i]);
+		if (opt == "-p")
+			pipelined = true;
+		else if (opt == "-k")
+			kernelParallel = true;
+		else if (opt == "-w")
+			slotParallel = true;
+		else if (opt == "-l")
+			laneSet = true;
+		else if (opt == "-j" && i + 1 < argc)
+			nThreads = std::max(1, std::stoi(argv[++i]));
+		else if (opt == "-C" && i + 1 < argc)
+			cacheDir = argv[++i];
+		else if (opt == "-S" && i + 1 < argc) {
+			sampled = true;
+			plan.fraction = std::stod(argv[++i]);
+		}
+		else if (opt == "-U" && i + 1 < argc)
+			plan.unitLen = std::stoull(argv[++i]);
+		else if (opt == "-W" && i + 1 < argc)
+			plan.warmLen = std::stoull(argv[++i]);
+		else if (opt == "-R")
+			plan.cta = true;
+		else if (opt == "-e" && i + 1 < argc)
+			plan.margin = std::stod(argv[++i]);
+		else if (opt == "-P" && i + 1 < argc)
+			simPointFile = argv[++i];
+		else if (opt == "-I" && i + 1 < argc)
+			simPointOpt.intervalLen = std::stoull(argv[++i]);
+		else if (opt == "--checkpoint" && i + 1 < argc)
+			ckpt.path = argv[++i];
+		else if (opt == "--every" && i + 1 < argc)
+			ckpt.every = std::stoull(argv[++i]);
+		else if (opt == "--prefix" && i + 1 < argc)
+			ckpt.prefix = std::stoull(argv[++i]);
+		else if ((opt == "--resume" || opt == "--fork") && i + 1 < argc) {
+			ckpt.fork = opt == "--fork";
+			ckpt.from = argv[++i];
+		}
+	}
+	if (pipelined + kernelParallel + slotParallel + laneSet > 1) {
+		std::cerr << "[RFC-sim] -p, -k, -w and -l are exclusive." << std::endl;
+		return 1;
+	}
+	if (sampled && !simPointFile.empty()) {
+		std::cerr << "[RFC-sim] -S and -P are exclusive." << std::endl;
+		return 1;
+	}
+	sampled |= !simPointFile.empty();
+	if (sampled && (pipelined || kernelParallel || slotParallel || laneSet)) {
+		std::cerr << "[RFC-sim] -S and -P run serially, without -p, -k, -w or -l." << std::endl;
+		return 1;
+	}
+
+	const bool checkpointed = !ckpt.path.empty() || !ckpt.from.empty();
+	if (checkpointed && (sampled || pipelined || kernelParallel || slotParallel || laneSet)) {
+		std::cerr << "[RFC-sim] Checkpointed runs are serial, without -S, -P, -p, -k, -w or -l." << std::endl;
+		return 1;
+	}
+	if ((ckpt.every || ckpt.prefix) && ckpt.path.empty()) {
+		std::cerr << "[RFC-sim] --every and --prefix need --checkpoint." << std::endl;
+		return 1;
+	}
+
 	std::cout << "[RFC-sim] Parsing input arguments..." << std::endl;
 	std::cout << "[RFC-sim] Trace file directory: " << traceListFile << std::endl;
 	std::cout << "[RFC-sim] Config file: " << cfgFile << std::endl;
     std::cout << "[RFC-sim] Assembly file: " << asmFile << std::endl;
 	
 	// detect all kernels
-	std::ifstream traceListIf(traceListFile);
-	std::string s;
-	std::vector<std::string> traceList;
-	while(std::getline(traceListIf, s)) {
-		if(s.substr(0, 6) == "kernel")
-			traceList.push_back(traceDir + "/" + s);
-	}
+	auto traceList = readTraceList(traceDir);
 	if(traceList.empty()) {
 		std::cerr << "[RFC-sim] Empty kernel list." << std::endl;
 		return 1;
@@ -55,81 +356,78 @@ int main(int argc, char ** argv) {
 	/*
 	############################################################################################################
 	*/
-	// Parse config
-	std::shared_ptr<cfg::GlobalCfg> cfg = std::make_shared<cfg::GlobalCfg>(); 
-    std::unique_ptr<cfg::CfgParser> cfgParser = std::make_unique<cfg::CfgParser>(cfgFile, cfg);
-	cfgParser->parse();
-	std::cout << "\n-----------------------------------------------------------------------------------------\n";
-	cfgParser->print();
-	std::cout << "\n-----------------------------------------------------------------------------------------\n\n";
-
-	using mapT = std::unordered_map<uint32_t, std::bitset<4>>;
-	std::unique_ptr<AsmParser> asmParser = std::make_unique<AsmParser>(
-		asmFile, 
-		std::make_shared<std::vector<mapT>>(),
-		std::make_shared<std::unordered_map<std::string, size_t>>()
-	);
-	asmParser->parse();
+	// Parse configs, one simulation per config
+	std::vector<std::unique_ptr<Sim>> sims;
+	for (auto & f : cfgList) {
+		std::shared_ptr<cfg::GlobalCfg> cfg = std::make_shared<cfg::GlobalCfg>(); 
+		std::unique_ptr<cfg::CfgParser> cfgParser = std::make_unique<cfg::CfgParser>(f, cfg);
+		cfgParser->parse();
+		std::cout << "\n-----------------------------------------------------------------------------------------\n";
+		cfgParser->print();
+		std::cout << "\n-----------------------------------------------------------------------------------------\n\n";
+		sims.push_back(std::make_unique<Sim>(cfg));
+	}
 
-	std::unique_ptr<TraceParser> traceParser = std::make_unique<TraceParser>(
-		traceList.at(0), 
-		asmParser->tab,
-		asmParser->map
-	);
+	auto asmParser = openInputs(asmFile, cacheDir, traceList);
 
-	// statistics
-	auto eMdl = cfg->eMdl;
-	std::shared_ptr<stat::Stat> scoreboardBase = std::make_shared<stat::Stat>(eMdl);
-	std::shared_ptr<stat::Stat> scoreboard = std::make_shared<stat::Stat>(eMdl);
+	// Phases are profiled once per trace and reused by every later run
+	if (!simPointFile.empty()) {
+		auto phases = std::make_shared<SimPoint::Phases>();
+		if (std::filesystem::exists(simPointFile)) {
+			phases->load(simPointFile);
+		} else {
+			std::cout << "[RFC-sim] Profiling SimPoint phases >>> " << simPointFile << std::endl;
+			*phases = SimPoint::profile(traceList, asmParser, simPointOpt);
+			phases->save(simPointFile);
+		}
+		std::cout << "[RFC-sim] SimPoint phases: " << phases->rep.size() << " of " << phases->label.size()
+				  << " intervals of " << phases->intervalLen << " instructions" << std::endl;
+		plan.phases = phases;
+	}
 
 	// RFC
     std::cout << "[RFC-sim] Simulating >>> " << std::endl;
-	std::vector<Rfc> rfcArry;
-
-	// Initialize RFC instance for each warp on SM core (e.g., for TU102, 4 sub-core * 8 warps = 32)
-	for (auto i = 0; i < 32; i++)
-		rfcArry.push_back(Rfc(cfg, scoreboardBase, scoreboard));
-	
-	// Traverse GPU Kernels
-	for(auto & traceFile : traceList) {
-		traceParser->reset(traceFile);
-
-		bool eof = false;
-		while(!eof) {
-			auto inst = traceParser->parse();
-
-#ifndef NDEBUG
-			while(true) {
-				char ch = std::cin.get();
-				if(ch == '\n') 
-					break;
-			}
-#endif
-
-			eof = rfcArry.at(inst.wId % 32).exec(inst);
-			
-#ifndef NDEBUG
-			std::cout << "[RFC] " << rfcArry.at(inst.wId % 32) << std::endl;
-			std::cout << "'[Stat] " << *scoreboard << std::endl;
-#endif
-		}
+	std::vector<Sampling::Estimate> estimates;
+	bool complete = true; // false after a --prefix warm-up, whose partial counters are not logged
+	if (sampled)
+		estimates = Sampling::run(traceList, asmParser, sims, plan);
+	else if (checkpointed) {
+		if (!ckpt.from.empty())
+			std::cout << "[RFC-sim] " << (ckpt.fork ? "Forking from " : "Resuming from ") << ckpt.from << std::endl;
+		complete = Checkpoint::run(traceList, asmParser, sims, ckpt);
+		if (!complete)
+			std::cout << "[RFC-sim] Stopped after " << ckpt.prefix << " instructions >>> " << ckpt.path << std::endl;
 	}
-    
+	else if (kernelParallel)
+		SimDriver::runKernelParallel(traceList, asmParser, sims, nThreads);
+	else if (laneSet)
+		SimDriver::runLaneSet(traceList, asmParser, sims, nThreads);
+	else if (slotParallel)
+		SimDriver::runSlotParallel(traceList, asmParser, sims, nThreads);
+	else if (pipelined)
+		SimDriver::runPipelined(traceList, asmParser, sims);
+	else
+		SimDriver::run(traceList, asmParser, sims);
 	std::cout << "[RFC-sim] <<< Simulation End" << std::endl;
 
-	std::cout << "--------------------------------------------------------------------------------\n";
-	std::cout << "[RFC-sim] Statistics " << std::endl;
-	std::cout << *scoreboardBase << std::endl;
-	std::cout << *scoreboard << std::endl;
-	stat::Stat::printCmp(*scoreboardBase, *scoreboard);
-	std::cout << std::endl;
-	std::cout << "--------------------------------------------------------------------------------\n";
-
-	// Logging
-	std::ofstream of(logFile, std::ios::app);
-	if (of.is_open()) {
-		Logger::logging(of, *cfg, *scoreboardBase, *scoreboard);
-		of.close();
+	for (size_t i = 0; i < sims.size(); i++) {
+		auto & sim = sims[i];
+		std::cout << "--------------------------------------------------------------------------------\n";
+		std::cout << "[RFC-sim] Statistics " << (complete ? "" : "(warm-up prefix, not logged) ") << std::endl;
+		sim->report(std::cout);
+		if (sampled)
+			Sampling::report(std::cout, estimates[i], plan);
+		std::cout << std::endl;
+		std::cout << "--------------------------------------------------------------------------------\n";
+
+		// Logging
+		if (!complete)
+			continue;
+		std::ofstream of(logFile, std::ios::app);
+		if (of.is_open()) {
+			Logger::logging(of, *sim->cfg, *sim->scbBase, *sim->scb);
+			of.close();
+		}
 	}
     std::cout << "[RFC-sim] End.\n\n";
 	return 0;